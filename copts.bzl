@@ -0,0 +1,9 @@
+# Compiler options for the targets that compile the batch kernels of the
+# generated constraints. -fopenmp-simd vectorizes their omp simd loops without
+# linking OpenMP, and -fno-math-errno lets the square roots in them vectorize.
+# The kernels are in headers, so the targets that include the constraints need
+# these too, since copts don't propagate to dependents.
+GCS_COPTS = [
+    "-fopenmp-simd",
+    "-fno-math-errno",
+]
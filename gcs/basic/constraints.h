@@ -3,6 +3,7 @@
 
 #include <ceres/ceres.h>
 
+#include <cmath>
 #include <metal.hpp>
 #include <vector>
 
@@ -21,35 +22,65 @@ struct SetConstant : gcs::Constraint {
 
     struct Functor_0 {
         static const metal::int_ num_params = 1;
-        double value;
+        const double* value;
 
         template <typename T>
         bool operator()(const T* var, T* r) const {
-            *r = equate(*var, value);
+            *r = equate(*var, *value);
+            return true;
+        }
+    };
+    struct CostFunction_0 : ceres::SizedCostFunction<1, 1> {
+        const double* value;
+
+        explicit CostFunction_0(const double* value) : value{value} {}
+
+        bool Evaluate(double const* const* parameters,
+                      double* residuals,
+                      double** jacobians) const {
+            const double var = parameters[0][0];
+
+            residuals[0] = equate(var, *value);
+            if (!jacobians) {
+                return true;
+            }
+
+            if (jacobians[0]) {
+                jacobians[0][0] = 1;
+            }
             return true;
         }
     };
 
     void add_to_problem(ceres::Problem& problem) {
-        problem.AddResidualBlock(
-            gcs::create_scalar_autodiff(new Functor_0{value}),
-            nullptr,
-            &var->value);
+        problem.AddResidualBlock(new CostFunction_0{&value},
+                                 nullptr,
+                                 &var->value);
     }
 
-    std::vector<gcs::Equation*> get_equations() const {
+    std::vector<gcs::Equation*> get_equations(gcs::Arena& arena) const {
         std::vector<gcs::Equation*> eqns{};
 
-        eqns.push_back(new Equation{
-            {var}, [&](ceres::Problem& problem) {
-                problem.AddResidualBlock(
-                    gcs::create_scalar_autodiff(new Functor_0{value}),
-                    nullptr,
-                    &var->value);
-            }});
+        eqns.push_back(arena.make_equation(
+            {var},
+            [&](ceres::Problem& problem) {
+                problem.AddResidualBlock(new CostFunction_0{&value},
+                                         nullptr,
+                                         &var->value);
+            },
+            "equate",
+            {&var->value, &value}));
 
         return eqns;
     }
+
+    const char* type_name() const { return "gcs.basic.SetConstant"; }
+
+    std::vector<gcs::Constraint::Argument> get_arguments() const {
+        return {{nullptr, var}};
+    }
+
+    std::vector<double> get_parameters() const { return {value}; }
 };
 
 struct Equate : gcs::Constraint {
@@ -67,28 +98,57 @@ struct Equate : gcs::Constraint {
             return true;
         }
     };
+    struct CostFunction_0 : ceres::SizedCostFunction<1, 1, 1> {
+        bool Evaluate(double const* const* parameters,
+                      double* residuals,
+                      double** jacobians) const {
+            const double v1 = parameters[0][0];
+            const double v2 = parameters[1][0];
+
+            residuals[0] = equate(v1, v2);
+            if (!jacobians) {
+                return true;
+            }
+
+            if (jacobians[0]) {
+                jacobians[0][0] = 1;
+            }
+            if (jacobians[1]) {
+                jacobians[1][0] = -1;
+            }
+            return true;
+        }
+    };
 
     void add_to_problem(ceres::Problem& problem) {
-        problem.AddResidualBlock(gcs::create_scalar_autodiff(new Functor_0{}),
+        problem.AddResidualBlock(new CostFunction_0{},
                                  nullptr,
                                  &v1->value,
                                  &v2->value);
     }
 
-    std::vector<gcs::Equation*> get_equations() const {
+    std::vector<gcs::Equation*> get_equations(gcs::Arena& arena) const {
         std::vector<gcs::Equation*> eqns{};
 
-        eqns.push_back(
-            new Equation{{v1, v2}, [&](ceres::Problem& problem) {
-                             problem.AddResidualBlock(
-                                 gcs::create_scalar_autodiff(new Functor_0{}),
-                                 nullptr,
-                                 &v1->value,
-                                 &v2->value);
-                         }});
+        eqns.push_back(arena.make_equation(
+            {v1, v2},
+            [&](ceres::Problem& problem) {
+                problem.AddResidualBlock(new CostFunction_0{},
+                                         nullptr,
+                                         &v1->value,
+                                         &v2->value);
+            },
+            "equate",
+            {&v1->value, &v2->value}));
 
         return eqns;
     }
+
+    const char* type_name() const { return "gcs.basic.Equate"; }
+
+    std::vector<gcs::Constraint::Argument> get_arguments() const {
+        return {{nullptr, v1}, {nullptr, v2}};
+    }
 };
 
 struct Difference : gcs::Constraint {
@@ -108,32 +168,89 @@ struct Difference : gcs::Constraint {
             return true;
         }
     };
+    struct CostFunction_0 : ceres::SizedCostFunction<1, 1, 1, 1> {
+        bool Evaluate(double const* const* parameters,
+                      double* residuals,
+                      double** jacobians) const {
+            const double v1 = parameters[0][0];
+            const double v2 = parameters[1][0];
+            const double diff = parameters[2][0];
+
+            residuals[0] = difference(v1, v2, diff);
+            if (!jacobians) {
+                return true;
+            }
+
+            const bool t0 = v1 - v2 < 0;
+
+            if (jacobians[0]) {
+                jacobians[0][0] = t0 ? -1 : 1;
+            }
+            if (jacobians[1]) {
+                jacobians[1][0] = t0 ? 1 : -1;
+            }
+            if (jacobians[2]) {
+                jacobians[2][0] = -1;
+            }
+            return true;
+        }
+    };
 
     void add_to_problem(ceres::Problem& problem) {
-        problem.AddResidualBlock(gcs::create_scalar_autodiff(new Functor_0{}),
+        problem.AddResidualBlock(new CostFunction_0{},
                                  nullptr,
                                  &v1->value,
                                  &v2->value,
                                  &diff->value);
     }
 
-    std::vector<gcs::Equation*> get_equations() const {
+    std::vector<gcs::Equation*> get_equations(gcs::Arena& arena) const {
         std::vector<gcs::Equation*> eqns{};
 
-        eqns.push_back(
-            new Equation{{v1, v2, diff}, [&](ceres::Problem& problem) {
-                             problem.AddResidualBlock(
-                                 gcs::create_scalar_autodiff(new Functor_0{}),
-                                 nullptr,
-                                 &v1->value,
-                                 &v2->value,
-                                 &diff->value);
-                         }});
+        eqns.push_back(arena.make_equation(
+            {v1, v2, diff},
+            [&](ceres::Problem& problem) {
+                problem.AddResidualBlock(new CostFunction_0{},
+                                         nullptr,
+                                         &v1->value,
+                                         &v2->value,
+                                         &diff->value);
+            },
+            "difference",
+            {&v1->value, &v2->value, &diff->value}));
 
         return eqns;
     }
+
+    const char* type_name() const { return "gcs.basic.Difference"; }
+
+    std::vector<gcs::Constraint::Argument> get_arguments() const {
+        return {{nullptr, v1}, {nullptr, v2}, {nullptr, diff}};
+    }
 };
 
+//! Adds the constraints of this namespace to a registry, so that they can
+//! be loaded from a problem file
+inline void register_constraints(gcs::TypeRegistry& registry) {
+    registry.add_constraint(
+        "gcs.basic.SetConstant",
+        [](const gcs::ConstraintArguments& args) -> gcs::Constraint* {
+            return new SetConstant{args.variable(0), args.parameter(0)};
+        });
+    registry.add_constraint(
+        "gcs.basic.Equate",
+        [](const gcs::ConstraintArguments& args) -> gcs::Constraint* {
+            return new Equate{args.variable(0), args.variable(1)};
+        });
+    registry.add_constraint(
+        "gcs.basic.Difference",
+        [](const gcs::ConstraintArguments& args) -> gcs::Constraint* {
+            return new Difference{args.variable(0),
+                                  args.variable(1),
+                                  args.variable(2)};
+        });
+}
+
 }  // namespace basic
 
 }  // namespace gcs
@@ -0,0 +1,271 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include "gcs/bench/sketches.h"
+#include "gcs/core/core.h"
+
+namespace {
+
+//! Bytes currently allocated with operator new
+std::atomic<size_t> allocated_bytes{0};
+//! The most bytes allocated at once since the last call to start_memory
+std::atomic<size_t> peak_bytes{0};
+
+//! Size of the header in front of each allocation, which holds its size and
+//! keeps the allocation aligned for any type
+constexpr size_t header_size = alignof(std::max_align_t);
+
+void* allocate(size_t size) noexcept {
+    auto block = static_cast<char*>(std::malloc(size + header_size));
+    if (!block) {
+        return nullptr;
+    }
+    *reinterpret_cast<size_t*>(block) = size;
+
+    auto now = allocated_bytes.fetch_add(size) + size;
+    auto peak = peak_bytes.load();
+    while (now > peak && !peak_bytes.compare_exchange_weak(peak, now)) {
+    }
+    return block + header_size;
+}
+
+void deallocate(void* ptr) noexcept {
+    if (!ptr) {
+        return;
+    }
+    auto block = static_cast<char*>(ptr) - header_size;
+    allocated_bytes.fetch_sub(*reinterpret_cast<size_t*>(block));
+    std::free(block);
+}
+
+}  // namespace
+
+// count every allocation made with new (which is all of the memory of gcs,
+// though not the matrices that ceres makes with Eigen, which use malloc)
+void* operator new(size_t size) {
+    if (auto ptr = allocate(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc{};
+}
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+void operator delete(void* ptr) noexcept { deallocate(ptr); }
+void operator delete[](void* ptr) noexcept { deallocate(ptr); }
+void operator delete(void* ptr, size_t) noexcept { deallocate(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { deallocate(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+    deallocate(ptr);
+}
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+    deallocate(ptr);
+}
+
+namespace {
+
+using Generator = gcs::bench::Sketch (*)(size_t, uint32_t);
+
+//! Starts measuring the peak memory of a benchmark
+//!
+//! @returns the bytes allocated before the benchmark, which aren't counted
+size_t start_memory() {
+    auto now = allocated_bytes.load();
+    peak_bytes.store(now);
+    return now;
+}
+
+//! @returns the most memory that was allocated at once since start_memory
+//! (by the sketch, the problem and solving it), in megabytes
+double peak_memory(size_t start) {
+    return (peak_bytes.load() - start) / (1024.0 * 1024.0);
+}
+
+//! Measures the shape of the dependency graph of a split problem
+//!
+//! The depth is the number of equation sets on the longest chain of
+//! dependencies, and the width is the largest number of equation sets at the
+//! same depth (which could be solved at the same time).
+void measure_graph(const gcs::Problem& problem, size_t& depth, size_t& width) {
+    gcs::DependencyGraph graph{problem.equation_sets, problem.is_prereq_of};
+
+    std::vector<uint32_t> levels(graph.size(), 0);
+    std::vector<uint32_t> remaining = graph.num_prereqs;
+    std::vector<uint32_t> ready{};
+    for (uint32_t id = 0; id < graph.size(); ++id) {
+        if (remaining[id] == 0) {
+            ready.push_back(id);
+        }
+    }
+
+    while (!ready.empty()) {
+        auto id = ready.back();
+        ready.pop_back();
+
+        for (auto k = graph.successor_offsets[id];
+             k < graph.successor_offsets[id + 1];
+             ++k) {
+            auto next = graph.successors[k];
+            levels[next] = std::max(levels[next], levels[id] + 1);
+            if (--remaining[next] == 0) {
+                ready.push_back(next);
+            }
+        }
+    }
+
+    std::vector<size_t> level_sizes{};
+    for (auto level : levels) {
+        if (level >= level_sizes.size()) {
+            level_sizes.resize(level + 1, 0);
+        }
+        ++level_sizes[level];
+    }
+
+    depth = level_sizes.size();
+    width = level_sizes.empty()
+                ? 0
+                : *std::max_element(level_sizes.begin(), level_sizes.end());
+}
+
+//! Time to split a sketch, starting from a single equation set
+void BM_Split(benchmark::State& state, Generator generate) {
+    const auto memory = start_memory();
+    auto sketch = generate(state.range(0), 1);
+    gcs::Problem problem{};
+    sketch.add_to(problem);
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        problem.reset_to_single_equation_set();
+        state.ResumeTiming();
+
+        problem.split();
+    }
+
+    size_t depth = 0;
+    size_t width = 0;
+    measure_graph(problem, depth, width);
+
+    state.counters["constraints"] = sketch.constraints.size();
+    state.counters["equation_sets"] = problem.equation_sets.size();
+    state.counters["dag_depth"] = depth;
+    state.counters["dag_width"] = width;
+    state.counters["peak_mb"] = peak_memory(memory);
+}
+
+//! Makespan of solving a split sketch from its starting values
+void BM_Solve(benchmark::State& state, Generator generate) {
+    const auto memory = start_memory();
+    auto sketch = generate(state.range(0), 1);
+    gcs::Problem problem{};
+    sketch.add_to(problem);
+    problem.split();
+    const auto start = problem.snapshot();
+
+    gcs::SolveResult result{};
+    for (auto _ : state) {
+        problem.restore(start);
+        result = problem.solve();
+        state.SetIterationTime(result.wall_time);
+    }
+
+    state.counters["constraints"] = sketch.constraints.size();
+    state.counters["equation_sets"] = result.num_equation_sets;
+    state.counters["direct"] = result.num_direct;
+    state.counters["failed"] = result.num_failed;
+    state.counters["peak_mb"] = peak_memory(memory);
+}
+
+//! Latency of changing one driving dimension of a solved sketch and solving
+//! what depends on it
+void BM_EditDimension(benchmark::State& state, Generator generate) {
+    const auto memory = start_memory();
+    auto sketch = generate(state.range(0), 1);
+    gcs::Problem problem{};
+    sketch.add_to(problem);
+    problem.split();
+    problem.solve();
+
+    // nudge the dimensions in a fixed order, back and forth
+    size_t i = 0;
+    size_t num_solved = 0;
+    for (auto _ : state) {
+        const size_t n = sketch.dimensions.size();
+        auto dimension = sketch.dimensions[(i * 7919) % n];
+        dimension->value *= (i / n) % 2 == 0 ? 1.01 : 1.0 / 1.01;
+        problem.mark_dirty(dimension);
+        num_solved += problem.solve_dirty().num_equation_sets;
+        ++i;
+    }
+
+    state.counters["constraints"] = sketch.constraints.size();
+    state.counters["sets_per_edit"] =
+        i == 0 ? 0.0 : static_cast<double>(num_solved) / i;
+    state.counters["peak_mb"] = peak_memory(memory);
+}
+
+//! Latency of removing or adding back one constraint of a solved sketch,
+//! which re-splits and re-solves the affected equation sets
+void BM_EditStructure(benchmark::State& state, Generator generate) {
+    const auto memory = start_memory();
+    auto sketch = generate(state.range(0), 1);
+    gcs::Problem problem{};
+    sketch.add_to(problem);
+    problem.split();
+    problem.solve();
+
+    // each iteration is one edit: the dimension is removed, then added back
+    auto dimension = sketch.dimensions[sketch.dimensions.size() / 2];
+    bool removed = false;
+    for (auto _ : state) {
+        if (removed) {
+            problem.add(static_cast<gcs::Constraint*>(dimension));
+        } else {
+            problem.remove(static_cast<gcs::Constraint*>(dimension));
+        }
+        removed = !removed;
+    }
+    if (removed) {
+        problem.add(static_cast<gcs::Constraint*>(dimension));
+    }
+
+    state.counters["constraints"] = sketch.constraints.size();
+    state.counters["equation_sets"] = problem.equation_sets.size();
+    state.counters["peak_mb"] = peak_memory(memory);
+}
+
+}  // namespace
+
+//! Registers a benchmark for each size of a sketch, from 100 to 100000
+//! constraints
+#define GCS_SKETCH_BENCHMARK(func, sketch)                      \
+    BENCHMARK_CAPTURE(func, sketch, &gcs::bench::make_##sketch) \
+        ->RangeMultiplier(10)                                   \
+        ->Range(100, 100000)
+
+#define GCS_SKETCH_BENCHMARKS(sketch)                 \
+    GCS_SKETCH_BENCHMARK(BM_Split, sketch)            \
+        ->Unit(benchmark::kMillisecond);              \
+    GCS_SKETCH_BENCHMARK(BM_Solve, sketch)            \
+        ->UseManualTime()                             \
+        ->Unit(benchmark::kMillisecond);              \
+    GCS_SKETCH_BENCHMARK(BM_EditDimension, sketch)    \
+        ->Unit(benchmark::kMicrosecond);              \
+    GCS_SKETCH_BENCHMARK(BM_EditStructure, sketch)    \
+        ->Unit(benchmark::kMicrosecond)
+
+GCS_SKETCH_BENCHMARKS(chain);
+GCS_SKETCH_BENCHMARKS(grid);
+GCS_SKETCH_BENCHMARKS(truss);
+GCS_SKETCH_BENCHMARKS(circle_pack);
+GCS_SKETCH_BENCHMARKS(mixed);
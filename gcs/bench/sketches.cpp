@@ -0,0 +1,410 @@
+#include "gcs/bench/sketches.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <utility>
+
+namespace gcs {
+
+namespace bench {
+
+namespace {
+
+//! A location in a known solution of a sketch
+struct Position {
+    double x;
+    double y;
+};
+
+double distance(const Position& a, const Position& b) {
+    return std::hypot(b.x - a.x, b.y - a.y);
+}
+
+//! Angle of a line as measured by AngleOfLine
+double line_angle(const Position& p1, const Position& p2) {
+    return std::abs(std::atan2(p1.x - p2.x, p1.y - p2.y));
+}
+
+//! Makes the parts of a sketch, starting each variable of the geometry close
+//! to its value in the known solution
+class Builder {
+   public:
+    Builder(Sketch& sketch, uint32_t seed) : sketch{sketch}, rng{seed} {}
+
+    size_t num_constraints() const { return sketch.constraints.size(); }
+
+    //! @returns a random number in [min, max)
+    double uniform(double min, double max) {
+        return std::uniform_real_distribution<double>{min, max}(rng);
+    }
+
+    //! @returns a random index in [0, size)
+    size_t index(size_t size) {
+        return std::uniform_int_distribution<size_t>{0, size - 1}(rng);
+    }
+
+    g2d::Point& point(const Position& p) {
+        return add_geometry(new g2d::Point{perturb(p.x), perturb(p.y)});
+    }
+
+    g2d::Line& line(const Position& p1, const Position& p2) {
+        return add_geometry(new g2d::Line{{perturb(p1.x), perturb(p1.y)},
+                                          {perturb(p2.x), perturb(p2.y)}});
+    }
+
+    g2d::Circle& circle(const Position& center, double radius) {
+        return add_geometry(new g2d::Circle{
+            {perturb(center.x), perturb(center.y)}, perturb(radius)});
+    }
+
+    template <typename T, typename... Args>
+    T& constrain(Args&&... args) {
+        auto cstr = new T{std::forward<Args>(args)...};
+        sketch.constraints.emplace_back(cstr);
+        return *cstr;
+    }
+
+    //! Fixes a variable at its value in the known solution
+    void fix(Variable& var, double value) {
+        constrain<basic::SetConstant>(var, value);
+    }
+
+    //! Sets a variable to a driving dimension
+    void dimension(Variable& var, double value) {
+        sketch.dimensions.push_back(&constrain<basic::SetConstant>(var, value));
+    }
+
+    //! @returns a new variable that is set to a driving dimension
+    Variable& dimension(double value) {
+        auto var = new Variable{value};
+        sketch.variables.emplace_back(var);
+        dimension(*var, value);
+        return *var;
+    }
+
+   private:
+    template <typename T>
+    T& add_geometry(T* geom) {
+        sketch.geometries.emplace_back(geom);
+        return *geom;
+    }
+
+    double perturb(double value) { return value + noise(rng); }
+
+    Sketch& sketch;
+    std::mt19937 rng;
+    std::normal_distribution<double> noise{0.0, 0.01};
+};
+
+}  // namespace
+
+void Sketch::add_to(Problem& problem) const {
+    Problem::EditScope edit{problem};
+
+    for (auto& var : variables) {
+        problem.add(var.get());
+    }
+    for (auto& geom : geometries) {
+        problem.add(geom.get());
+    }
+    for (auto& constraint : constraints) {
+        problem.add(constraint.get());
+    }
+
+    // takes the pending constraints, so the edit doesn't split or solve
+    problem.reset_to_single_equation_set();
+}
+
+Sketch make_chain(size_t num_constraints, uint32_t seed) {
+    Sketch sketch{};
+    Builder builder{sketch, seed};
+
+    Position start{0.0, 0.0};
+    double heading = 0.0;
+    g2d::Line* prev = nullptr;
+
+    while (builder.num_constraints() < num_constraints) {
+        heading += builder.uniform(-0.5, 0.5);
+        const double length = builder.uniform(0.5, 1.5);
+        const Position end{start.x + length * std::cos(heading),
+                           start.y + length * std::sin(heading)};
+
+        auto& line = builder.line(start, end);
+        if (prev) {
+            builder.constrain<g2d::CoincidentPoints>(prev->p2, line.p1);
+        } else {
+            builder.fix(line.p1.x, start.x);
+            builder.fix(line.p1.y, start.y);
+        }
+        builder.constrain<g2d::LineLength>(line, builder.dimension(length));
+        builder.constrain<g2d::AngleOfLine>(
+            line, builder.dimension(line_angle(start, end)));
+
+        prev = &line;
+        start = end;
+    }
+
+    return sketch;
+}
+
+Sketch make_grid(size_t num_constraints, uint32_t seed) {
+    Sketch sketch{};
+    Builder builder{sketch, seed};
+
+    // each corner takes 2 constraints
+    const size_t size = std::max<size_t>(
+        2, static_cast<size_t>(std::sqrt(num_constraints / 2.0)));
+
+    std::vector<double> widths(size, 0.0);
+    std::vector<double> heights(size, 0.0);
+    std::vector<Position> corners(size * size);
+    for (size_t i = 1; i < size; ++i) {
+        widths[i] = builder.uniform(0.5, 1.5);
+        heights[i] = builder.uniform(0.5, 1.5);
+    }
+    for (size_t i = 0; i < size; ++i) {
+        for (size_t j = 0; j < size; ++j) {
+            corners[i * size + j] = {
+                j == 0 ? 0.0 : corners[i * size + j - 1].x + widths[j],
+                i == 0 ? 0.0 : corners[(i - 1) * size + j].y + heights[i]};
+        }
+    }
+
+    std::vector<g2d::Point*> points(size * size);
+    for (size_t k = 0; k < points.size(); ++k) {
+        points[k] = &builder.point(corners[k]);
+    }
+
+    for (size_t i = 0; i < size; ++i) {
+        for (size_t j = 0; j < size; ++j) {
+            auto& p = *points[i * size + j];
+
+            if (i == 0 && j == 0) {
+                builder.fix(p.x, 0.0);
+                builder.fix(p.y, 0.0);
+            } else if (i == 0) {
+                auto& left = *points[j - 1];
+                builder.constrain<basic::Equate>(left.y, p.y);
+                builder.constrain<g2d::DistancePoints>(
+                    left, p, builder.dimension(widths[j]));
+            } else if (j == 0) {
+                auto& below = *points[(i - 1) * size];
+                builder.constrain<basic::Equate>(below.x, p.x);
+                builder.constrain<g2d::DistancePoints>(
+                    below, p, builder.dimension(heights[i]));
+            } else {
+                builder.constrain<basic::Equate>(
+                    points[(i - 1) * size + j]->x, p.x);
+                builder.constrain<basic::Equate>(points[i * size + j - 1]->y,
+                                                 p.y);
+            }
+        }
+    }
+
+    return sketch;
+}
+
+Sketch make_truss(size_t num_constraints, uint32_t seed) {
+    Sketch sketch{};
+    Builder builder{sketch, seed};
+
+    // joints alternate between the bottom and top chords
+    std::vector<Position> joints{};
+    std::vector<g2d::Point*> points{};
+
+    while (builder.num_constraints() < num_constraints) {
+        const size_t k = joints.size();
+        const Position joint{k * 0.5 + builder.uniform(-0.1, 0.1),
+                             k % 2 == 0 ? 0.0 : builder.uniform(0.7, 0.9)};
+        auto& p = builder.point(joint);
+
+        if (k == 0) {
+            builder.fix(p.x, joint.x);
+            builder.fix(p.y, joint.y);
+        } else if (k == 1) {
+            builder.constrain<basic::Difference>(
+                points[0]->y,
+                p.y,
+                builder.dimension(std::abs(joint.y - joints[0].y)));
+            builder.constrain<g2d::DistancePoints>(
+                *points[0], p, builder.dimension(distance(joints[0], joint)));
+        } else {
+            for (size_t m = k - 2; m < k; ++m) {
+                builder.constrain<g2d::DistancePoints>(
+                    *points[m],
+                    p,
+                    builder.dimension(distance(joints[m], joint)));
+            }
+        }
+
+        joints.push_back(joint);
+        points.push_back(&p);
+    }
+
+    return sketch;
+}
+
+Sketch make_circle_pack(size_t num_constraints, uint32_t seed) {
+    Sketch sketch{};
+    Builder builder{sketch, seed};
+
+    // teeth fill 12 of 16 slots around each hub
+    const size_t num_slots = 16;
+    const size_t num_teeth = 12;
+    const double slot_angle = 2.0 * M_PI / num_slots;
+    const double s = std::sin(slot_angle / 2.0);
+
+    Position prev_center{0.0, 0.0};
+    double prev_extent = 0.0;
+    g2d::Circle* prev_hub = nullptr;
+
+    while (builder.num_constraints() < num_constraints) {
+        const double hub_radius = builder.uniform(0.8, 1.2);
+        // touching teeth, and each tooth touching the hub
+        const double tooth_radius = hub_radius * s / (1.0 - s);
+        const double extent = hub_radius + 2.0 * tooth_radius;
+        const Position center{
+            prev_hub ? prev_center.x + prev_extent + extent + 0.1 : 0.0, 0.0};
+
+        auto& hub = builder.circle(center, hub_radius);
+        builder.dimension(hub.radius, hub_radius);
+        if (prev_hub) {
+            builder.constrain<basic::Equate>(prev_hub->center.y, hub.center.y);
+            builder.constrain<g2d::DistancePoints>(
+                prev_hub->center,
+                hub.center,
+                builder.dimension(distance(prev_center, center)));
+        } else {
+            builder.fix(hub.center.x, center.x);
+            builder.fix(hub.center.y, center.y);
+        }
+
+        g2d::Circle* prev_tooth = nullptr;
+        for (size_t j = 0; j < num_teeth; ++j) {
+            const double angle = M_PI / 2.0 + j * slot_angle;
+            const double r = hub_radius + tooth_radius;
+            const Position tooth_center{center.x + r * std::cos(angle),
+                                        center.y + r * std::sin(angle)};
+
+            auto& tooth = builder.circle(tooth_center, tooth_radius);
+            builder.dimension(tooth.radius, tooth_radius);
+            builder.constrain<g2d::DistancePoints>(
+                hub.center, tooth.center, builder.dimension(r));
+            if (prev_tooth) {
+                builder.constrain<g2d::DistancePoints>(
+                    prev_tooth->center,
+                    tooth.center,
+                    builder.dimension(2.0 * tooth_radius));
+            } else {
+                builder.constrain<basic::Equate>(hub.center.x, tooth.center.x);
+            }
+
+            prev_tooth = &tooth;
+        }
+
+        prev_center = center;
+        prev_extent = extent;
+        prev_hub = &hub;
+    }
+
+    return sketch;
+}
+
+Sketch make_mixed(size_t num_constraints, uint32_t seed) {
+    Sketch sketch{};
+    Builder builder{sketch, seed};
+
+    std::vector<Position> positions{{0.0, 0.0}};
+    std::vector<g2d::Point*> points{&builder.point(positions[0])};
+    builder.fix(points[0]->x, 0.0);
+    builder.fix(points[0]->y, 0.0);
+
+    while (builder.num_constraints() < num_constraints) {
+        const size_t a = builder.index(points.size());
+        const Position& base = positions[a];
+        auto& from = *points[a];
+
+        const double heading = builder.uniform(0.0, 2.0 * M_PI);
+        const double length = builder.uniform(0.5, 1.5);
+        const Position target{base.x + length * std::cos(heading),
+                              base.y + length * std::sin(heading)};
+        const Position offset{std::abs(target.x - base.x),
+                              std::abs(target.y - base.y)};
+
+        switch (builder.index(4)) {
+            case 0: {
+                // a line from an earlier point, by its length and angle
+                auto& line = builder.line(base, target);
+                builder.constrain<g2d::CoincidentPoints>(from, line.p1);
+                builder.constrain<g2d::LineLength>(line,
+                                                   builder.dimension(length));
+                builder.constrain<g2d::AngleOfLine>(
+                    line, builder.dimension(line_angle(base, target)));
+
+                positions.push_back(target);
+                points.push_back(&line.p2);
+                break;
+            }
+            case 1: {
+                // a point by its distances to two earlier points
+                const size_t c = builder.index(points.size());
+                if (c == a) {
+                    continue;
+                }
+
+                auto& p = builder.point(target);
+                builder.constrain<g2d::DistancePoints>(
+                    from, p, builder.dimension(length));
+                builder.constrain<g2d::DistancePoints>(
+                    *points[c],
+                    p,
+                    builder.dimension(distance(positions[c], target)));
+
+                positions.push_back(target);
+                points.push_back(&p);
+                break;
+            }
+            case 2: {
+                // a point by its offsets from an earlier point
+                auto& p = builder.point(target);
+                builder.constrain<basic::Difference>(
+                    from.x, p.x, builder.dimension(offset.x));
+                builder.constrain<basic::Difference>(
+                    from.y, p.y, builder.dimension(offset.y));
+
+                positions.push_back(target);
+                points.push_back(&p);
+                break;
+            }
+            default: {
+                // a circle offset from an earlier point, with a point on it
+                const double radius = builder.uniform(0.2, 0.5);
+                const Position on_circle{target.x + radius, target.y};
+
+                auto& circle = builder.circle(target, radius);
+                builder.dimension(circle.radius, radius);
+                builder.constrain<basic::Difference>(
+                    from.x, circle.center.x, builder.dimension(offset.x));
+                builder.constrain<basic::Difference>(
+                    from.y, circle.center.y, builder.dimension(offset.y));
+
+                auto& p = builder.point(on_circle);
+                builder.constrain<basic::Equate>(circle.center.y, p.y);
+                builder.constrain<g2d::PointOnCircle>(p, circle);
+
+                positions.push_back(target);
+                points.push_back(&circle.center);
+                positions.push_back(on_circle);
+                points.push_back(&p);
+                break;
+            }
+        }
+    }
+
+    return sketch;
+}
+
+}  // namespace bench
+
+}  // namespace gcs
@@ -0,0 +1,63 @@
+#ifndef GCS_BENCH_SKETCHES
+#define GCS_BENCH_SKETCHES
+
+#include <cstdint>
+#include <vector>
+
+#include "gcs/basic/basic.h"
+#include "gcs/core/core.h"
+#include "gcs/g2d/g2d.h"
+
+namespace gcs {
+
+namespace bench {
+
+//! A generated sketch, which owns its variables, geometry and constraints
+//!
+//! Sketches are fully constrained. The dimensions are computed from a known
+//! solution, and the variables of the geometry start out close to it (with
+//! some noise), so that every equation set converges to the same branch.
+struct Sketch {
+    //! Variables that aren't part of any geometry, such as dimensions
+    std::vector<uptr<Variable>> variables;
+    std::vector<uptr<Geometry>> geometries;
+    std::vector<uptr<Constraint>> constraints;
+    //! The constraints that set the driving dimensions (lengths, angles and
+    //! offsets), which can be changed to edit the sketch
+    std::vector<basic::SetConstant*> dimensions;
+
+    //! Adds all constraints to a problem, without splitting or solving it
+    //!
+    //! The problem is left with a single equation set, ready to split.
+    void add_to(Problem& problem) const;
+};
+
+//! A chain of lines joined end to end, each with a length and an angle
+//!
+//! @param num_constraints the number of constraints to make (the sketch may
+//! have a few more)
+//! @param seed seed of the random turns and lengths
+Sketch make_chain(size_t num_constraints, uint32_t seed = 1);
+
+//! A grid of rectangles that share their corners, with a width for each
+//! column and a height for each row
+Sketch make_grid(size_t num_constraints, uint32_t seed = 1);
+
+//! A Warren truss, where each joint is located by the lengths of the two
+//! members to the previous joints
+Sketch make_truss(size_t num_constraints, uint32_t seed = 1);
+
+//! A row of gear-like circle packs: each hub circle has a ring of tooth
+//! circles around it, and each circle is located by the distances between
+//! centers of touching circles
+Sketch make_circle_pack(size_t num_constraints, uint32_t seed = 1);
+
+//! A random mix of g2d constraints, where each new point or circle is
+//! located relative to random earlier ones
+Sketch make_mixed(size_t num_constraints, uint32_t seed = 1);
+
+}  // namespace bench
+
+}  // namespace gcs
+
+#endif  // GCS_BENCH_SKETCHES
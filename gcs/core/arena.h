@@ -0,0 +1,156 @@
+#ifndef GCS_CORE_ARENA
+#define GCS_CORE_ARENA
+
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "gcs/core/solve_elements.h"
+
+namespace gcs {
+
+//! Pool of objects of a single type, allocated from large blocks
+//!
+//! Destroyed objects return their slot to a free list, so a pool that keeps
+//! making and destroying objects stays the same size. All objects can be
+//! destroyed in one pass with clear(), which keeps the blocks for reuse.
+template <typename T>
+class ObjectPool {
+   public:
+    ObjectPool() = default;
+    ~ObjectPool() { clear(); }
+
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    //! Constructs an object in the pool
+    //!
+    //! @param args the arguments of the constructor of T
+    //! @returns the new object, which is owned by the pool
+    template <typename... Args>
+    T* make(Args&&... args) {
+        if (!free_slots) {
+            grow();
+        }
+
+        auto slot = free_slots;
+        auto object = new (&slot->storage) T(std::forward<Args>(args)...);
+        free_slots = slot->next;
+        slot->live = true;
+        ++num_live;
+        return object;
+    }
+
+    //! Destroys an object that was made by this pool
+    void destroy(T* object) {
+        // storage is the first member of a slot
+        auto slot = reinterpret_cast<Slot*>(object);
+        object->~T();
+        slot->live = false;
+        slot->next = free_slots;
+        free_slots = slot;
+        --num_live;
+    }
+
+    //! Destroys all objects in the pool
+    void clear() {
+        free_slots = nullptr;
+        for (auto block = blocks.rbegin(); block != blocks.rend(); ++block) {
+            for (size_t i = block->size; i-- > 0;) {
+                auto& slot = block->slots[i];
+                if (slot.live) {
+                    reinterpret_cast<T*>(&slot.storage)->~T();
+                    slot.live = false;
+                }
+                slot.next = free_slots;
+                free_slots = &slot;
+            }
+        }
+        num_live = 0;
+    }
+
+    //! Calls a function with each object in the pool
+    template <typename Function>
+    void for_each(Function&& function) {
+        for (auto& block : blocks) {
+            for (size_t i = 0; i < block.size; ++i) {
+                if (block.slots[i].live) {
+                    function(*reinterpret_cast<T*>(&block.slots[i].storage));
+                }
+            }
+        }
+    }
+
+    //! @returns the number of objects in the pool
+    size_t size() const { return num_live; }
+
+   private:
+    struct Slot {
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+        Slot* next;
+        bool live;
+    };
+
+    struct Block {
+        std::unique_ptr<Slot[]> slots;
+        size_t size;
+    };
+
+    //! Adds a block, which is twice the size of the last one (up to a limit)
+    void grow() {
+        size_t size = blocks.empty() ? 64 : std::min(blocks.back().size * 2,
+                                                     size_t{4096});
+        blocks.push_back(Block{std::unique_ptr<Slot[]>{new Slot[size]}, size});
+
+        auto& block = blocks.back();
+        for (size_t i = size; i-- > 0;) {
+            block.slots[i].live = false;
+            block.slots[i].next = free_slots;
+            free_slots = &block.slots[i];
+        }
+    }
+
+    std::vector<Block> blocks;
+    Slot* free_slots = nullptr;
+    size_t num_live = 0;
+};
+
+//! Owns the equations and equation sets of a problem
+//!
+//! Constraints make their equations in the arena of the problem they are
+//! added to. Everything in the arena belongs to the current structure of the
+//! problem, and is destroyed at once when the problem is reset.
+struct Arena {
+    ObjectPool<Equation> equations;
+    ObjectPool<EquationSet> equation_sets;
+
+    //! Makes an equation that is owned by this arena
+    //!
+    //! @see Equation::Equation
+    Equation* make_equation(
+        decltype(Equation::variables)&& vars,
+        decltype(Equation::make_residual_ftor) make_residual_ftor,
+        std::string function = {},
+        decltype(Equation::arguments) arguments = {},
+        BatchKernel batch_kernel = nullptr) {
+        return equations.make(std::move(vars),
+                              std::move(make_residual_ftor),
+                              std::move(function),
+                              std::move(arguments),
+                              batch_kernel);
+    }
+
+    //! Destroys all equations and equation sets
+    void clear() {
+        equation_sets.clear();
+        equations.clear();
+    }
+};
+
+}  // namespace gcs
+
+#endif  // GCS_CORE_ARENA
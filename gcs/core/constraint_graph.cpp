@@ -0,0 +1,43 @@
+#include "gcs/core/constraint_graph.h"
+
+namespace gcs {
+
+ConstraintGraph::ConstraintGraph(const EquationSet& equation_set)
+    : equations{equation_set.equations.begin(),
+                equation_set.equations.end()} {
+    eqn_offsets.reserve(equations.size() + 1);
+    eqn_offsets.push_back(0);
+
+    for (Id e = 0; e < equations.size(); ++e) {
+        auto eqn = equations[e];
+        eqn->id = e;
+
+        for (auto& var : eqn->variables) {
+            if (!contains(var)) {
+                var->id = variables.size();
+                variables.push_back(var);
+            }
+            eqn_vars.push_back(var->id);
+        }
+        eqn_offsets.push_back(eqn_vars.size());
+    }
+
+    // transpose the equation -> variable adjacency with a counting sort
+    var_offsets.assign(variables.size() + 1, 0);
+    for (auto v : eqn_vars) {
+        ++var_offsets[v + 1];
+    }
+    for (Id v = 0; v < variables.size(); ++v) {
+        var_offsets[v + 1] += var_offsets[v];
+    }
+
+    std::vector<Id> cursor{var_offsets.begin(), var_offsets.end() - 1};
+    var_eqns.resize(eqn_vars.size());
+    for (Id e = 0; e < equations.size(); ++e) {
+        for (auto v : variables_of(e)) {
+            var_eqns[cursor[v]++] = e;
+        }
+    }
+}
+
+}  // namespace gcs
@@ -0,0 +1,76 @@
+#ifndef GCS_CORE_CONSTRAINT_GRAPH
+#define GCS_CORE_CONSTRAINT_GRAPH
+
+#include <cstdint>
+#include <vector>
+
+#include "gcs/core/solve_elements.h"
+
+namespace gcs {
+
+//! Compact view of the bipartite graph between equations and variables
+//!
+//! Equations and variables are numbered with contiguous 32-bit ids, and the
+//! adjacency in both directions is stored in compressed sparse row (CSR)
+//! arrays. Building a graph assigns Equation::id and Variable::id, so the
+//! objects themselves can be used to index into the graph.
+struct ConstraintGraph {
+    //! Type used for equation and variable ids
+    using Id = uint32_t;
+
+    //! A contiguous range of ids
+    struct Range {
+        const Id* first;
+        const Id* last;
+
+        const Id* begin() const { return first; }
+        const Id* end() const { return last; }
+        size_t size() const { return last - first; }
+        Id operator[](size_t i) const { return first[i]; }
+    };
+
+    //! The equations of this graph, indexed by id
+    std::vector<Equation*> equations;
+    //! The variables of this graph, indexed by id
+    std::vector<Variable*> variables;
+
+    //! The variables of equation e are
+    //! eqn_vars[eqn_offsets[e]] ... eqn_vars[eqn_offsets[e + 1] - 1]
+    std::vector<Id> eqn_offsets;
+    std::vector<Id> eqn_vars;
+    //! The equations of variable v are
+    //! var_eqns[var_offsets[v]] ... var_eqns[var_offsets[v + 1] - 1]
+    std::vector<Id> var_offsets;
+    std::vector<Id> var_eqns;
+
+    ConstraintGraph() = default;
+
+    //! Builds the graph for an equation set
+    //!
+    //! Uses the current variables of each equation, so variables that are
+    //! held constant after splitting aren't part of the graph.
+    explicit ConstraintGraph(const EquationSet& equation_set);
+
+    Id num_equations() const { return equations.size(); }
+    Id num_variables() const { return variables.size(); }
+
+    //! @returns the ids of the variables used by an equation
+    Range variables_of(Id eqn) const {
+        return {eqn_vars.data() + eqn_offsets[eqn],
+                eqn_vars.data() + eqn_offsets[eqn + 1]};
+    }
+    //! @returns the ids of the equations that use a variable
+    Range equations_of(Id var) const {
+        return {var_eqns.data() + var_offsets[var],
+                var_eqns.data() + var_offsets[var + 1]};
+    }
+
+    //! @returns true if the variable is part of this graph
+    bool contains(const Variable* var) const {
+        return var->id < variables.size() && variables[var->id] == var;
+    }
+};
+
+}  // namespace gcs
+
+#endif  // GCS_CORE_CONSTRAINT_GRAPH
@@ -7,6 +7,8 @@
 #include <cmath>
 #include <metal.hpp>
 
+#include "gcs/core/arena.h"
+#include "gcs/core/geometry.h"
 #include "gcs/core/solve_elements.h"
 
 namespace gcs {
@@ -16,6 +18,16 @@ namespace gcs {
 //! Constraint is a higher level class that may add multiple equations to be
 //! solved.
 struct Constraint {
+    //! A geometry or variable that a constraint is defined on
+    struct Argument {
+        //! The geometry, or null if the argument is a variable
+        Geometry* geometry;
+        //! The variable, or null if the argument is a geometry
+        Variable* variable;
+    };
+
+    virtual ~Constraint() = default;
+
     // virtual std::vector<Equation> get_equations() = 0;  // TODO
 
     //! Add equations to a ceres Problem
@@ -23,9 +35,24 @@ struct Constraint {
 
     //! Makes new equations based on the definition of this constraint
     //!
-    //! @returns A vector of equations, which the caller is given ownership of
+    //! @param arena the arena to make the equations in
+    //! @returns A vector of equations, which are owned by the arena
     //! @see gcs::Equation
-    virtual std::vector<gcs::Equation*> get_equations() const = 0;
+    virtual std::vector<gcs::Equation*> get_equations(
+        gcs::Arena& arena) const = 0;
+
+    //! Name of this type of constraint, which is used to make it again when a
+    //! problem is loaded (empty if it can't be saved)
+    //! @see TypeRegistry
+    virtual const char* type_name() const { return ""; }
+
+    //! @returns the geometry and variables this constraint is defined on, in
+    //! the order they are passed to its constructor
+    virtual std::vector<Argument> get_arguments() const { return {}; }
+
+    //! @returns the constants of this constraint (such as the value of a
+    //! SetConstant), in the order they are passed to its constructor
+    virtual std::vector<double> get_parameters() const { return {}; }
 };
 
 //! A macro that creates constraint functors
@@ -4,9 +4,14 @@
 //! @file
 //! Core objects and functions for geometric constraint solving
 
+#include "gcs/core/constraint_graph.h"
 #include "gcs/core/constraints.h"
+#include "gcs/core/dependency_graph.h"
+#include "gcs/core/direct_solve.h"
+#include "gcs/core/flat_set.h"
 #include "gcs/core/geometry.h"
 #include "gcs/core/problem.h"
+#include "gcs/core/problem_file.h"
 #include "gcs/core/solve_elements.h"
 #include "gcs/core/split_equation_sets.h"
 
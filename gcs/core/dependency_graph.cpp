@@ -0,0 +1,239 @@
+#include "gcs/core/dependency_graph.h"
+
+#include <algorithm>
+#include <numeric>
+#include <thread>
+
+namespace gcs {
+
+DependencyGraph::DependencyGraph(
+    const std::unordered_set<EquationSet*>& targets,
+    const std::unordered_map<EquationSet*, std::unordered_set<EquationSet*>>&
+        is_prereq_of)
+    : equation_sets{targets.begin(), targets.end()} {
+    for (Id i = 0; i < equation_sets.size(); ++i) {
+        equation_sets[i]->id = i;
+    }
+
+    successor_offsets.reserve(equation_sets.size() + 1);
+    successor_offsets.push_back(0);
+    num_prereqs.assign(equation_sets.size(), 0);
+
+    for (auto& eqn_set : equation_sets) {
+        auto it = is_prereq_of.find(eqn_set);
+
+        if (it != is_prereq_of.end()) {
+            for (auto& dep : it->second) {
+                if (contains(dep)) {
+                    successors.push_back(dep->id);
+                    ++num_prereqs[dep->id];
+                }
+            }
+        }
+        successor_offsets.push_back(successors.size());
+    }
+
+    // fuse linear chains
+    chain_next.assign(equation_sets.size(), none);
+    for (Id i = 0; i < equation_sets.size(); ++i) {
+        if (successor_offsets[i + 1] - successor_offsets[i] == 1) {
+            auto next = successors[successor_offsets[i]];
+            if (num_prereqs[next] == 1) {
+                chain_next[i] = next;
+            }
+        }
+    }
+}
+
+constexpr DependencyGraph::Id DependencyGraph::none;
+
+std::vector<DependencyGraph::Id> DependencyGraph::topological_order() const {
+    std::vector<Id> order{};
+    order.reserve(size());
+
+    auto remaining = num_prereqs;
+    for (Id i = 0; i < size(); ++i) {
+        if (remaining[i] == 0) {
+            order.push_back(i);
+        }
+    }
+    for (size_t k = 0; k < order.size(); ++k) {
+        auto i = order[k];
+        for (auto j = successor_offsets[i]; j < successor_offsets[i + 1]; ++j) {
+            if (--remaining[successors[j]] == 0) {
+                order.push_back(successors[j]);
+            }
+        }
+    }
+
+    return order;
+}
+
+std::vector<double> DependencyGraph::critical_path_costs(
+    const std::vector<double>& costs) const {
+    auto order = topological_order();
+
+    // accumulate from the end of the graph
+    std::vector<double> path_costs(size(), 0.0);
+    for (auto it = order.rbegin(); it != order.rend(); ++it) {
+        auto i = *it;
+        double longest = 0.0;
+        for (auto j = successor_offsets[i]; j < successor_offsets[i + 1]; ++j) {
+            longest = std::max(longest, path_costs[successors[j]]);
+        }
+        path_costs[i] = costs[i] + longest;
+    }
+
+    return path_costs;
+}
+
+std::vector<double> estimate_solve_costs(const DependencyGraph& graph) {
+    std::vector<double> model_costs(graph.size());
+    double measured_time = 0.0;
+    double measured_cost = 0.0;
+
+    for (DependencyGraph::Id i = 0; i < graph.size(); ++i) {
+        auto& eqn_set = *graph.equation_sets[i];
+        double num_equations = eqn_set.equations.size();
+        double num_variables = eqn_set.get_variables().size();
+        model_costs[i] =
+            std::max(num_equations * num_variables * num_variables, 1.0);
+
+        if (eqn_set.solve_time > 0.0) {
+            measured_time += eqn_set.solve_time;
+            measured_cost += model_costs[i];
+        }
+    }
+
+    // without measurements, the model costs are only compared with each other
+    double seconds_per_cost =
+        measured_cost > 0.0 ? measured_time / measured_cost : 1.0;
+
+    std::vector<double> costs(graph.size());
+    for (DependencyGraph::Id i = 0; i < graph.size(); ++i) {
+        auto solve_time = graph.equation_sets[i]->solve_time;
+        costs[i] = solve_time > 0.0 ? solve_time
+                                    : model_costs[i] * seconds_per_cost;
+    }
+    return costs;
+}
+
+DependencyCounters::DependencyCounters(const DependencyGraph& graph)
+    : remaining(graph.size()) {
+    for (Id i = 0; i < graph.size(); ++i) {
+        remaining[i].store(graph.num_prereqs[i], std::memory_order_relaxed);
+    }
+    for (Id i = 0; i < graph.size(); ++i) {
+        if (graph.chain_next[i] != DependencyGraph::none) {
+            remaining[graph.chain_next[i]].store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+bool DependencyCounters::all_released() const {
+    for (auto& count : remaining) {
+        if (count.load() != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+constexpr ReadyQueue::Id ReadyQueue::word_bits;
+constexpr ReadyQueue::Id ReadyQueue::unset;
+
+ReadyQueue::ReadyQueue(Id capacity) : slots(capacity) {
+    for (auto& slot : slots) {
+        slot.store(unset, std::memory_order_relaxed);
+    }
+}
+
+ReadyQueue::ReadyQueue(const std::vector<double>& priorities)
+    : ranks(priorities.size()),
+      ids(priorities.size()),
+      words((priorities.size() + word_bits - 1) / word_bits),
+      summary((priorities.size() + word_bits * word_bits - 1) /
+              (word_bits * word_bits)) {
+    std::iota(ids.begin(), ids.end(), 0);
+    std::stable_sort(ids.begin(), ids.end(), [&](Id a, Id b) {
+        return priorities[a] > priorities[b];
+    });
+    for (Id rank = 0; rank < ids.size(); ++rank) {
+        ranks[ids[rank]] = rank;
+    }
+
+    for (auto& word : words) {
+        word.store(0, std::memory_order_relaxed);
+    }
+    for (auto& word : summary) {
+        word.store(0, std::memory_order_relaxed);
+    }
+}
+
+void ReadyQueue::push(Id id) {
+    if (!ids.empty()) {
+        // the word is marked in the summary after its bit is set, so a pop
+        // that finds the summary bit also finds the word bit
+        auto rank = ranks[id];
+        auto w = rank / word_bits;
+        words[w].fetch_or(Word{1} << (rank % word_bits));
+        summary[w / word_bits].fetch_or(Word{1} << (w % word_bits));
+        return;
+    }
+
+    auto i = tail.fetch_add(1, std::memory_order_acq_rel);
+    slots[i].store(id, std::memory_order_release);
+}
+
+bool ReadyQueue::pop(Id& id) {
+    if (!ids.empty()) {
+        return pop_ranked(id);
+    }
+
+    auto i = head.load(std::memory_order_acquire);
+    while (i < tail.load(std::memory_order_acquire)) {
+        if (head.compare_exchange_weak(i, i + 1, std::memory_order_acq_rel)) {
+            // the slot may have been claimed by a push that hasn't written it
+            // yet, which only takes a moment
+            while ((id = slots[i].load(std::memory_order_acquire)) == unset) {
+                std::this_thread::yield();
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ReadyQueue::pop_ranked(Id& id) {
+    for (Id s = 0; s < summary.size(); ++s) {
+        auto active = summary[s].load();
+
+        while (active != 0) {
+            Id sw = __builtin_ctzll(active);
+            auto w = s * word_bits + sw;
+
+            auto bits = words[w].load();
+            while (bits != 0) {
+                Id b = __builtin_ctzll(bits);
+                auto mask = Word{1} << b;
+                if (words[w].fetch_and(~mask) & mask) {
+                    id = ids[w * word_bits + b];
+                    return true;
+                }
+                bits = words[w].load();
+            }
+
+            // the word is empty, but a push may set a bit between emptying
+            // the word and clearing its summary bit, so check again after
+            summary[s].fetch_and(~(Word{1} << sw));
+            if (words[w].load() != 0) {
+                summary[s].fetch_or(Word{1} << sw);
+                continue;
+            }
+            active &= ~(Word{1} << sw);
+        }
+    }
+    return false;
+}
+
+}  // namespace gcs
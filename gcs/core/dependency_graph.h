@@ -0,0 +1,182 @@
+#ifndef GCS_CORE_DEPENDENCY_GRAPH
+#define GCS_CORE_DEPENDENCY_GRAPH
+
+#include <atomic>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "gcs/core/solve_elements.h"
+
+namespace gcs {
+
+//! Order in which ready equation sets are solved
+enum class SchedulePolicy {
+    //! Equation sets are solved in the order they become ready
+    fifo,
+    //! The ready equation set with the most expensive path to the end of the
+    //! dependency graph is solved first, so long chains of equation sets
+    //! start as early as possible
+    critical_path,
+};
+
+//! Flat dependency graph between equation sets, used to schedule solving
+//!
+//! Equation sets are numbered with contiguous 32-bit ids (which are written
+//! to EquationSet::id) and the sets that depend on each equation set are
+//! stored in compressed sparse row (CSR) arrays.
+struct DependencyGraph {
+    //! Type used for equation set ids
+    using Id = uint32_t;
+
+    //! The equation sets to solve, indexed by id
+    std::vector<EquationSet*> equation_sets;
+    //! The equation sets that depend on equation set i are
+    //! successors[successor_offsets[i]] ... successors[successor_offsets[i+1]-1]
+    std::vector<Id> successor_offsets;
+    std::vector<Id> successors;
+    //! The number of prerequisites of each equation set within this graph
+    std::vector<Id> num_prereqs;
+    //! The equation set that is fused after each equation set, or none
+    //!
+    //! An equation set is fused after another if it's the only one that
+    //! depends on the other, and the other is its only prerequisite. Such
+    //! chains can't run in parallel anyway, so they are solved back to back
+    //! as a single task, without going through the ready queue.
+    std::vector<Id> chain_next;
+
+    //! Marks the end of a chain
+    static constexpr Id none = ~Id{0};
+
+    DependencyGraph() = default;
+
+    //! Builds the dependency graph for a subset of the equation sets of a
+    //! problem
+    //!
+    //! Dependencies on equation sets that aren't targets are ignored.
+    //!
+    //! @param targets the equation sets to include
+    //! @param is_prereq_of the equation sets that depend on each equation set
+    DependencyGraph(
+        const std::unordered_set<EquationSet*>& targets,
+        const std::unordered_map<EquationSet*, std::unordered_set<EquationSet*>>&
+            is_prereq_of);
+
+    Id size() const { return equation_sets.size(); }
+
+    //! @returns true if the equation set is part of this graph
+    bool contains(const EquationSet* eqn_set) const {
+        return eqn_set->id < equation_sets.size() &&
+               equation_sets[eqn_set->id] == eqn_set;
+    }
+
+    //! @returns the ids of the equation sets, in an order in which they can
+    //! be solved (every equation set comes after its prerequisites)
+    std::vector<Id> topological_order() const;
+
+    //! Computes the cost of the most expensive path from each equation set to
+    //! the end of the graph, including the equation set itself
+    //!
+    //! @param costs the cost of each equation set, indexed by id
+    //! @returns the path cost of each equation set, indexed by id
+    std::vector<double> critical_path_costs(
+        const std::vector<double>& costs) const;
+};
+
+//! Estimates how long each equation set of a graph takes to solve
+//!
+//! Equation sets that were solved before use their last solve time. The
+//! others are estimated from the number of equations and variables, as
+//! equations * variables^2 (the cost of a dense QR factorization), scaled to
+//! seconds by the ratio of measured time to estimated cost of the equation
+//! sets that were solved before.
+//!
+//! @returns the estimated cost of each equation set, indexed by id
+std::vector<double> estimate_solve_costs(const DependencyGraph& graph);
+
+//! Number of unsolved prerequisites of each equation set during a solve
+//!
+//! Counters are decremented atomically as prerequisites finish, so the thread
+//! that releases the last prerequisite of an equation set is the only one that
+//! sees it become ready, without taking a lock. Equation sets that are fused
+//! into a chain aren't counted, as they're solved right after their only
+//! prerequisite.
+struct DependencyCounters {
+    using Id = DependencyGraph::Id;
+
+    explicit DependencyCounters(const DependencyGraph& graph);
+
+    //! Records that one prerequisite of an equation set was solved
+    //!
+    //! @returns true if this was the last prerequisite, so the equation set is
+    //! ready to solve
+    bool release(Id id) {
+        return remaining[id].fetch_sub(1, std::memory_order_acq_rel) == 1;
+    }
+
+    //! @returns true if every prerequisite of every equation set was released
+    bool all_released() const;
+
+    std::vector<std::atomic<Id>> remaining;
+};
+
+//! Equation sets that are ready to solve, shared by the threads of a solve
+//!
+//! Every equation set becomes ready exactly once per solve, so the queue
+//! doesn't need to allocate while solving. Neither pushing nor popping takes a
+//! lock.
+//!
+//! In first in, first out order, the queue is a fixed array with one slot per
+//! equation set. Pushing claims the next slot with an atomic increment and
+//! popping claims the oldest filled slot with a compare and swap.
+//!
+//! In priority order, each equation set is given a rank, and the queue is a
+//! bitset indexed by rank with a summary bitset of the words that may be
+//! non-empty. Popping clears the lowest set bit.
+class ReadyQueue {
+   public:
+    using Id = DependencyGraph::Id;
+
+    //! Makes a first in, first out queue
+    //!
+    //! @param capacity the number of equation sets in the graph
+    explicit ReadyQueue(Id capacity);
+
+    //! Makes a priority queue
+    //!
+    //! @param priorities the priority of each equation set, indexed by id
+    //! (higher priorities are popped first)
+    explicit ReadyQueue(const std::vector<double>& priorities);
+
+    void push(Id id);
+
+    //! Takes the next equation set from the queue
+    //!
+    //! @returns false if the queue is empty
+    bool pop(Id& id);
+
+   private:
+    using Word = uint64_t;
+    static constexpr Id word_bits = 64;
+
+    //! Marks a slot that was claimed but not written yet
+    static constexpr Id unset = ~Id{0};
+
+    bool pop_ranked(Id& id);
+
+    // first in, first out order
+    std::vector<std::atomic<Id>> slots;
+    std::atomic<Id> head{0};
+    std::atomic<Id> tail{0};
+
+    // priority order (used if ids isn't empty)
+    std::vector<Id> ranks;
+    std::vector<Id> ids;
+    std::vector<std::atomic<Word>> words;
+    std::vector<std::atomic<Word>> summary;
+};
+
+}  // namespace gcs
+
+#endif  // GCS_CORE_DEPENDENCY_GRAPH
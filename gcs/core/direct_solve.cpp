@@ -0,0 +1,440 @@
+#include "gcs/core/direct_solve.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace gcs {
+
+namespace {
+
+//! Largest linear system that is solved directly
+constexpr size_t max_linear_size = 8;
+//! Relative tolerance used to check that a solution satisfies its equations
+constexpr double tolerance = 1e-9;
+
+//! An argument of an equation, resolved through any presolve aliases
+struct Argument {
+    //! The value the argument is relative to, or null for the constant zero
+    const double* base;
+    //! Offset of the argument from base
+    double offset;
+    //! Index of the unknown that base belongs to, or -1 if base is held
+    //! constant
+    int unknown;
+
+    double value() const { return (base ? *base : 0.0) + offset; }
+};
+
+//! An equation set, as a list of its equations and of the variables it solves
+//! for
+struct LocalSystem {
+    std::vector<Equation*> equations;
+    std::vector<Variable*> unknowns;
+    //! Where the value of each unknown is read and written
+    std::vector<double*> unknown_values;
+    //! The resolved arguments of each equation
+    std::vector<std::vector<Argument>> arguments;
+
+    //! Resolves an argument of one of the equations
+    Argument resolve(const double* arg,
+                     const Presolve* presolved,
+                     ValueStore* values) const {
+        Argument result{arg, 0.0, -1};
+
+        const Alias* alias = presolved ? presolved->find(arg) : nullptr;
+        if (alias) {
+            result.base = alias->representative
+                              ? &alias->representative->value
+                              : nullptr;
+            result.offset = alias->offset;
+        }
+        if (result.base && values) {
+            auto slot = values->find(result.base);
+            result.base = slot ? slot : result.base;
+        }
+
+        for (size_t i = 0; i < unknowns.size(); ++i) {
+            if (unknown_values[i] == result.base) {
+                result.unknown = i;
+            }
+        }
+        return result;
+    }
+};
+
+bool is_linear(const Equation& eq) {
+    return (eq.function == "equate" && eq.arguments.size() == 2) ||
+           (eq.function == "difference" && eq.arguments.size() == 3);
+}
+
+bool is_distance(const Equation& eq) {
+    return (eq.function == "distance" || eq.function == "point_on_circle" ||
+            eq.function == "line_length") &&
+           eq.arguments.size() == 5;
+}
+
+bool is_angle(const Equation& eq) {
+    return eq.function == "angle_point_2" && eq.arguments.size() == 5;
+}
+
+//! Evaluates the residual of an equation recognised by one of the rules
+double residual(const Equation& eq, const std::vector<Argument>& args) {
+    double a[5];
+    for (size_t k = 0; k < args.size() && k < 5; ++k) {
+        a[k] = args[k].value();
+    }
+
+    if (eq.function == "equate") {
+        return a[0] - a[1];
+    }
+    if (eq.function == "difference") {
+        return std::abs(a[0] - a[1]) - a[2];
+    }
+    if (is_distance(eq)) {
+        return std::hypot(a[2] - a[0], a[3] - a[1]) - std::abs(a[4]);
+    }
+    return std::abs(std::atan2(a[0] - a[2], a[1] - a[3])) - a[4];
+}
+
+//! Assigns values to the unknowns of a system, as long as every equation is
+//! then satisfied
+//!
+//! @returns true if the values were kept, false if they were rolled back
+bool assign(const LocalSystem& sys, const std::vector<double>& values) {
+    std::vector<double> old_values(values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+        old_values[i] = *sys.unknown_values[i];
+        *sys.unknown_values[i] = values[i];
+    }
+
+    for (size_t i = 0; i < sys.equations.size(); ++i) {
+        const auto& args = sys.arguments[i];
+
+        double scale = 1.0;
+        for (auto& arg : args) {
+            scale = std::max(scale, std::abs(arg.value()));
+        }
+
+        if (!(std::abs(residual(*sys.equations[i], args)) <=
+              tolerance * scale)) {
+            for (size_t j = 0; j < values.size(); ++j) {
+                *sys.unknown_values[j] = old_values[j];
+            }
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//! Picks the candidate value closest to a current value
+double closest(double current, double a, double b) {
+    return std::abs(a - current) <= std::abs(b - current) ? a : b;
+}
+
+//! Solves a system of "equate" and "difference" equations by Gaussian
+//! elimination
+bool solve_linear(const LocalSystem& sys) {
+    const size_t n = sys.unknowns.size();
+    if (n > max_linear_size) {
+        return false;
+    }
+    for (auto& eq : sys.equations) {
+        if (!is_linear(*eq)) {
+            return false;
+        }
+    }
+
+    // augmented matrix [A | b], row-major
+    std::vector<double> m(n * (n + 1), 0.0);
+    auto at = [&](size_t i, size_t j) -> double& { return m[i * (n + 1) + j]; };
+
+    for (size_t i = 0; i < n; ++i) {
+        const auto& args = sys.arguments[i];
+        double coefs[3] = {1.0, -1.0, 0.0};
+
+        if (sys.equations[i]->function == "difference") {
+            // |x1 - x2| = d is linear once the sign of x1 - x2 is fixed, which
+            // is taken from the current values
+            const double sign =
+                args[0].value() >= args[1].value() ? 1.0 : -1.0;
+            coefs[0] = sign;
+            coefs[1] = -sign;
+            coefs[2] = -1.0;
+        }
+
+        for (size_t k = 0; k < args.size(); ++k) {
+            if (args[k].unknown < 0) {
+                at(i, n) -= coefs[k] * args[k].value();
+            } else {
+                at(i, args[k].unknown) += coefs[k];
+                at(i, n) -= coefs[k] * args[k].offset;
+            }
+        }
+    }
+
+    // forward elimination with partial pivoting
+    for (size_t c = 0; c < n; ++c) {
+        size_t pivot = c;
+        for (size_t r = c + 1; r < n; ++r) {
+            if (std::abs(at(r, c)) > std::abs(at(pivot, c))) {
+                pivot = r;
+            }
+        }
+        if (std::abs(at(pivot, c)) < tolerance) {
+            // singular, so the equations don't determine the unknowns
+            return false;
+        }
+        if (pivot != c) {
+            for (size_t j = c; j <= n; ++j) {
+                std::swap(at(c, j), at(pivot, j));
+            }
+        }
+
+        for (size_t r = c + 1; r < n; ++r) {
+            const double f = at(r, c) / at(c, c);
+            for (size_t j = c; j <= n; ++j) {
+                at(r, j) -= f * at(c, j);
+            }
+        }
+    }
+
+    // back substitution
+    std::vector<double> values(n);
+    for (size_t c = n; c-- > 0;) {
+        double value = at(c, n);
+        for (size_t j = c + 1; j < n; ++j) {
+            value -= at(c, j) * values[j];
+        }
+        values[c] = value / at(c, c);
+    }
+
+    // the signs assumed for "difference" equations are checked here
+    return assign(sys, values);
+}
+
+//! Solves a single nonlinear equation for one of its arguments
+bool solve_single(const LocalSystem& sys) {
+    if (sys.equations.size() != 1) {
+        return false;
+    }
+
+    const auto& eq = *sys.equations[0];
+    const auto& args = sys.arguments[0];
+
+    // the unknown has to appear in exactly one argument
+    int k = -1;
+    for (int i = 0; i < static_cast<int>(args.size()); ++i) {
+        if (args[i].unknown >= 0) {
+            if (k >= 0) {
+                return false;
+            }
+            k = i;
+        }
+    }
+
+    double a[5];
+    for (size_t i = 0; i < args.size() && i < 5; ++i) {
+        a[i] = args[i].value();
+    }
+
+    double value;
+    if (is_angle(eq) && k == 4) {
+        value = std::abs(std::atan2(a[0] - a[2], a[1] - a[3]));
+    } else if (!is_distance(eq) || k < 0) {
+        return false;
+    } else if (k == 4) {
+        // keep the sign of the distance, since only its magnitude is used
+        const double d = std::hypot(a[2] - a[0], a[3] - a[1]);
+        value = a[4] < 0.0 ? -d : d;
+    } else {
+        // one coordinate of one of the points: the other coordinate difference
+        // is known, so this coordinate is one of two roots
+        const int axis = k % 2;
+        const int self = k < 2 ? 0 : 2;
+        const int other = 2 - self;
+        const double delta = a[other + 1 - axis] - a[self + 1 - axis];
+        const double disc = a[4] * a[4] - delta * delta;
+        if (disc < 0.0) {
+            return false;
+        }
+
+        const double root = std::sqrt(disc);
+        const double center = a[other + axis];
+        value = closest(a[k], center + root, center - root);
+    }
+
+    return assign(sys, {value - args[k].offset});
+}
+
+//! Finds which point of a "distance" or "angle_point_2" equation is made of
+//! the two unknowns of a system
+//!
+//! @returns 0 or 2 (the index of the point's x argument), or -1 if the
+//! equation doesn't solve for exactly one of its points
+int unknown_point(const std::vector<Argument>& args) {
+    for (int p = 0; p <= 2; p += 2) {
+        if (args[p].unknown < 0 || args[p + 1].unknown < 0 ||
+            args[p].unknown == args[p + 1].unknown) {
+            continue;
+        }
+
+        bool others_constant = true;
+        for (int k = 0; k < static_cast<int>(args.size()); ++k) {
+            if (k != p && k != p + 1 && args[k].unknown >= 0) {
+                others_constant = false;
+            }
+        }
+        if (others_constant) {
+            return p;
+        }
+    }
+
+    return -1;
+}
+
+//! Locates a 2d point from two distances, or from a distance and an angle
+bool solve_point(const LocalSystem& sys) {
+    if (sys.equations.size() != 2) {
+        return false;
+    }
+
+    size_t i1 = 0;
+    size_t i2 = 1;
+    if (is_angle(*sys.equations[i1])) {
+        std::swap(i1, i2);
+    }
+    const auto& eq1 = *sys.equations[i1];
+    const auto& eq2 = *sys.equations[i2];
+    if (!is_distance(eq1) || !(is_distance(eq2) || is_angle(eq2))) {
+        return false;
+    }
+
+    const auto& a1 = sys.arguments[i1];
+    const auto& a2 = sys.arguments[i2];
+    const int p1 = unknown_point(a1);
+    const int p2 = unknown_point(a2);
+    if (p1 < 0 || p2 < 0 || a1[p1].unknown != a2[p2].unknown ||
+        a1[p1 + 1].unknown != a2[p2 + 1].unknown) {
+        return false;
+    }
+
+    // the point is solved for as it appears in the first equation, and the
+    // second equation may see it shifted by different alias offsets
+    const double shift_x = a2[p2].offset - a1[p1].offset;
+    const double shift_y = a2[p2 + 1].offset - a1[p1 + 1].offset;
+    const double x0 = a1[p1].value();
+    const double y0 = a1[p1 + 1].value();
+
+    // the known point of each equation
+    const double q1x = a1[2 - p1].value();
+    const double q1y = a1[3 - p1].value();
+    const double q2x = a2[2 - p2].value() - shift_x;
+    const double q2y = a2[3 - p2].value() - shift_y;
+    const double r1 = std::abs(a1[4].value());
+
+    double cx[2];
+    double cy[2];
+
+    if (is_distance(eq2)) {
+        // intersection of two circles
+        const double r2 = std::abs(a2[4].value());
+        const double dx = q2x - q1x;
+        const double dy = q2y - q1y;
+        const double d = std::hypot(dx, dy);
+        if (d < tolerance) {
+            return false;
+        }
+
+        const double along = (r1 * r1 - r2 * r2 + d * d) / (2.0 * d);
+        double h2 = r1 * r1 - along * along;
+        if (h2 < 0.0) {
+            if (h2 < -tolerance * (1.0 + r1 * r1)) {
+                return false;
+            }
+            h2 = 0.0;
+        }
+        const double h = std::sqrt(h2);
+
+        const double bx = q1x + along * dx / d;
+        const double by = q1y + along * dy / d;
+        cx[0] = bx - h * dy / d;
+        cy[0] = by + h * dx / d;
+        cx[1] = bx + h * dy / d;
+        cy[1] = by - h * dx / d;
+    } else {
+        // angle_point_2 measures atan2(x1 - x2, y1 - y2), and both equations
+        // have to be relative to the same known point
+        const double angle = a2[4].value();
+        const double scale = 1.0 + std::abs(q1x) + std::abs(q1y);
+        if (std::abs(q1x - q2x) > tolerance * scale ||
+            std::abs(q1y - q2y) > tolerance * scale || angle < 0.0) {
+            return false;
+        }
+
+        const double sign = p2 == 0 ? 1.0 : -1.0;
+        for (int i = 0; i < 2; ++i) {
+            const double theta = i == 0 ? angle : -angle;
+            cx[i] = q1x + sign * r1 * std::sin(theta);
+            cy[i] = q1y + sign * r1 * std::cos(theta);
+        }
+    }
+
+    const int best = std::hypot(cx[0] - x0, cy[0] - y0) <=
+                             std::hypot(cx[1] - x0, cy[1] - y0)
+                         ? 0
+                         : 1;
+
+    std::vector<double> values(2);
+    values[a1[p1].unknown] = cx[best] - a1[p1].offset;
+    values[a1[p1 + 1].unknown] = cy[best] - a1[p1 + 1].offset;
+    return assign(sys, values);
+}
+
+}  // namespace
+
+bool direct_solve(const EquationSet& eqn_set,
+                  const Presolve* presolved,
+                  ValueStore* values) {
+    if (eqn_set.equations.empty() ||
+        eqn_set.equations.size() > max_linear_size) {
+        return false;
+    }
+
+    LocalSystem sys{};
+    sys.equations.assign(eqn_set.equations.begin(), eqn_set.equations.end());
+
+    for (auto& eq : sys.equations) {
+        if (eq->function.empty()) {
+            return false;
+        }
+        for (auto& var : eq->variables) {
+            if (std::find(sys.unknowns.begin(), sys.unknowns.end(), var) ==
+                sys.unknowns.end()) {
+                sys.unknowns.push_back(var);
+            }
+        }
+    }
+
+    // only constrained equation sets have a unique (local) solution
+    if (sys.unknowns.size() != sys.equations.size()) {
+        return false;
+    }
+
+    for (auto& var : sys.unknowns) {
+        auto slot = values ? values->find(&var->value) : nullptr;
+        sys.unknown_values.push_back(slot ? slot : &var->value);
+    }
+
+    sys.arguments.resize(sys.equations.size());
+    for (size_t i = 0; i < sys.equations.size(); ++i) {
+        for (auto& arg : sys.equations[i]->arguments) {
+            sys.arguments[i].push_back(sys.resolve(arg, presolved, values));
+        }
+    }
+
+    return solve_linear(sys) || solve_single(sys) || solve_point(sys);
+}
+
+}  // namespace gcs
@@ -0,0 +1,39 @@
+#ifndef GCS_CORE_DIRECT_SOLVE
+#define GCS_CORE_DIRECT_SOLVE
+
+#include "gcs/core/presolve.h"
+#include "gcs/core/solve_elements.h"
+#include "gcs/core/value_store.h"
+
+namespace gcs {
+
+//! Tries to solve a constrained equation set in closed form
+//!
+//! Equations are recognised by Equation::function and Equation::arguments.
+//! The rules that are currently available are:
+//!
+//!   - small linear systems of "equate" and "difference" equations (this
+//!     includes any single SetConstant, Equate or Difference)
+//!   - a single "distance" or "angle_point_2" equation that solves for its
+//!     distance or angle
+//!   - a 2d point located by two distances (the intersection of two circles)
+//!   - a 2d point located by a distance and an angle from another point
+//!
+//! When an equation set has several solutions, the one closest to the current
+//! values is used, which is the solution an iterative solve started from the
+//! current values would normally converge to.
+//!
+//! @param eqn_set an equation set that has been split and marked as solved
+//! @param presolved aliases of the variables eliminated by presolve, if any
+//! @param values the value store that holds the current values, if any
+//! (values that aren't in the store are read and written in place)
+//! @returns true if the variables of the equation set were assigned, or false
+//! (without changing any values) if no rule applies and the equation set has
+//! to be solved numerically
+bool direct_solve(const EquationSet& eqn_set,
+                  const Presolve* presolved = nullptr,
+                  ValueStore* values = nullptr);
+
+}  // namespace gcs
+
+#endif  // GCS_CORE_DIRECT_SOLVE
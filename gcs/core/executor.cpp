@@ -0,0 +1,181 @@
+#include "gcs/core/executor.h"
+
+#include <algorithm>
+
+namespace {
+
+//! The executor and worker index of the current thread, if it's a worker
+thread_local const gcs::Executor* current_executor = nullptr;
+thread_local size_t current_worker = 0;
+
+}  // namespace
+
+gcs::Executor::Executor(size_t num_threads) {
+    if (num_threads == 0) {
+        num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    for (size_t i = 0; i < num_threads; ++i) {
+        workers.emplace_back(new Worker{});
+    }
+    // workers are only started once all deques exist, as they steal from
+    // each other
+    for (size_t i = 0; i < num_threads; ++i) {
+        workers[i]->thread = std::thread{&Executor::work, this, i};
+    }
+}
+
+gcs::Executor::~Executor() {
+    {
+        std::lock_guard<std::mutex> lock{sleep_mtx};
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (auto& worker : workers) {
+        worker->thread.join();
+    }
+}
+
+void gcs::Executor::post(Task task) {
+    // stay on the current worker if possible, so dependent tasks run on a
+    // warm cache
+    auto i = current_executor == this
+                 ? current_worker
+                 : next.fetch_add(1, std::memory_order_relaxed) % size();
+
+    // counted before it's pushed, so the count can't drop below zero when the
+    // task is taken right away
+    queued.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock{workers[i]->mtx};
+        workers[i]->tasks.push_back(std::move(task));
+    }
+
+    // a worker counts itself as sleeping before it checks for tasks, so
+    // either it sees the task or this sees the worker. The lock orders this
+    // with a sleeping worker checking for tasks, so the notification can't
+    // be lost
+    if (sleeping.load() > 0) {
+        {
+            std::lock_guard<std::mutex> lock{sleep_mtx};
+        }
+        wake.notify_one();
+    }
+}
+
+void gcs::Executor::post(TaskGroup& group, Task task) {
+    {
+        std::lock_guard<std::mutex> lock{group.mtx};
+        ++group.pending;
+    }
+
+    post([&group, task = std::move(task)]() {
+        task();
+
+        // notify while holding the lock, as the group may be destroyed as
+        // soon as a waiter sees that it's done
+        std::lock_guard<std::mutex> lock{group.mtx};
+        if (--group.pending == 0) {
+            group.done.notify_all();
+        }
+    });
+
+    // a thread waiting on the group may have found nothing to run, so wake it
+    // to pick up the new task. The group can't have finished yet, as this is
+    // called by its owner or by one of its tasks
+    if (group.waiting.load() > 0) {
+        std::lock_guard<std::mutex> lock{group.mtx};
+        ++group.posted;
+        group.done.notify_all();
+    }
+}
+
+bool gcs::Executor::run_one() {
+    Task task;
+    auto i = current_executor == this ? current_worker : size();
+    if ((i < size() && pop(i, task)) || steal(i, task)) {
+        task();
+        return true;
+    }
+    return false;
+}
+
+std::shared_ptr<gcs::Executor> gcs::Executor::shared() {
+    static std::shared_ptr<Executor> executor{new Executor{}};
+    return executor;
+}
+
+void gcs::Executor::work(size_t i) {
+    current_executor = this;
+    current_worker = i;
+
+    while (true) {
+        if (run_one()) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock{sleep_mtx};
+        sleeping.fetch_add(1);
+        wake.wait(lock, [&] { return stopping || queued.load() > 0; });
+        sleeping.fetch_sub(1);
+        if (stopping && queued.load() == 0) {
+            return;
+        }
+    }
+}
+
+bool gcs::Executor::pop(size_t i, Task& task) {
+    auto& worker = *workers[i];
+    std::lock_guard<std::mutex> lock{worker.mtx};
+    if (worker.tasks.empty()) {
+        return false;
+    }
+
+    task = std::move(worker.tasks.back());
+    worker.tasks.pop_back();
+    queued.fetch_sub(1);
+    return true;
+}
+
+bool gcs::Executor::steal(size_t i, Task& task) {
+    for (size_t k = 1; k <= size(); ++k) {
+        auto j = (i + k) % size();
+        if (j == i) {
+            continue;
+        }
+
+        auto& victim = *workers[j];
+        std::lock_guard<std::mutex> lock{victim.mtx};
+        if (victim.tasks.empty()) {
+            continue;
+        }
+
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        queued.fetch_sub(1);
+        return true;
+    }
+    return false;
+}
+
+void gcs::Executor::TaskGroup::wait() {
+    std::unique_lock<std::mutex> lock{mtx};
+    waiting.fetch_add(1);
+
+    while (pending != 0) {
+        auto seen = posted;
+        lock.unlock();
+
+        // help out instead of blocking a worker
+        bool ran = executor.run_one();
+
+        lock.lock();
+        if (!ran) {
+            // tasks of the group are running on other threads
+            done.wait(lock, [&] { return pending == 0 || posted != seen; });
+        }
+    }
+
+    waiting.fetch_sub(1);
+}
@@ -0,0 +1,127 @@
+#ifndef GCS_CORE_EXECUTOR
+#define GCS_CORE_EXECUTOR
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace gcs {
+
+//! A long-lived pool of worker threads with work stealing
+//!
+//! Each worker has its own deque of tasks. Tasks posted from a worker thread
+//! go to the back of that worker's deque and are run last in, first out,
+//! which keeps a chain of dependent equation sets on the same thread. Tasks
+//! posted from any other thread are spread over the workers round robin. An
+//! idle worker steals from the front of the other deques, so short tasks
+//! don't all contend on a single queue.
+//!
+//! One executor is meant to be shared by many problems (see shared()), so
+//! that solving doesn't create and join threads on every call.
+class Executor {
+   public:
+    using Task = std::function<void()>;
+
+    //! Tracks a group of tasks so that they can be waited on together
+    //!
+    //! @see Executor::post(TaskGroup&, Task)
+    class TaskGroup {
+       public:
+        explicit TaskGroup(Executor& executor) : executor{executor} {}
+        ~TaskGroup() { wait(); }
+
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+
+        //! Waits until every task of the group has finished
+        //!
+        //! The calling thread runs queued tasks while it waits, so waiting
+        //! from inside a task of the same executor can't deadlock. When there
+        //! are none, it sleeps until a task of the group finishes or a new
+        //! one is posted.
+        void wait();
+
+       private:
+        friend class Executor;
+
+        Executor& executor;
+        //! Number of tasks that haven't finished (guarded by mtx)
+        size_t pending = 0;
+        //! Number of tasks posted while a thread was waiting (guarded by mtx)
+        size_t posted = 0;
+        //! Number of threads in wait(), which are only notified of new tasks
+        //! when there are any (changed while holding mtx)
+        std::atomic<size_t> waiting{0};
+        std::mutex mtx;
+        std::condition_variable done;
+    };
+
+    //! Starts the worker threads
+    //!
+    //! @param num_threads the number of workers. If not given, defaults to the
+    //! hardware concurrency value.
+    explicit Executor(size_t num_threads = 0);
+
+    //! Runs the remaining tasks, then joins the worker threads
+    ~Executor();
+
+    Executor(const Executor&) = delete;
+    Executor& operator=(const Executor&) = delete;
+
+    //! @returns the number of worker threads
+    size_t size() const { return workers.size(); }
+
+    //! Queues a task to run on one of the workers
+    void post(Task task);
+
+    //! Queues a task that belongs to a group
+    void post(TaskGroup& group, Task task);
+
+    //! Runs a single queued task on the calling thread, if there is one
+    //!
+    //! @returns true if a task was run
+    bool run_one();
+
+    //! @returns the executor shared by all problems that don't have their
+    //! own, which is created on first use
+    static std::shared_ptr<Executor> shared();
+
+   private:
+    struct Worker {
+        std::mutex mtx;
+        std::deque<Task> tasks;
+        std::thread thread;
+    };
+
+    //! Main loop of worker i
+    void work(size_t i);
+
+    //! Pops the newest task of worker i
+    bool pop(size_t i, Task& task);
+    //! Steals the oldest task of any worker other than i (if i is a valid
+    //! worker)
+    bool steal(size_t i, Task& task);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    //! Number of tasks in all deques
+    std::atomic<size_t> queued{0};
+    //! Next worker to receive a task posted from outside the executor
+    std::atomic<size_t> next{0};
+
+    //! Idle workers sleep on this until tasks are queued
+    std::mutex sleep_mtx;
+    std::condition_variable wake;
+    bool stopping = false;
+    //! Number of workers that are (about to be) asleep, so that posting a
+    //! task only takes sleep_mtx when there's a worker to wake
+    std::atomic<size_t> sleeping{0};
+};
+
+}  // namespace gcs
+
+#endif  // GCS_CORE_EXECUTOR
@@ -0,0 +1,95 @@
+#ifndef GCS_CORE_FLAT_SET
+#define GCS_CORE_FLAT_SET
+
+#include <algorithm>
+#include <functional>
+#include <initializer_list>
+#include <utility>
+#include <vector>
+
+namespace gcs {
+
+//! Set of pointers stored as a sorted vector
+//!
+//! Used for the variables of an equation, which are bounded by the arity of
+//! its function. Unlike std::unordered_set it needs no heap node per element
+//! and no hashing, and its elements are contiguous. Inserting and erasing are
+//! linear in the size of the set, and invalidate iterators, so building a set
+//! of n elements is O(n^2): don't use it for sets without a small bound, such
+//! as the equations of a variable.
+//!
+//! The interface is the subset of std::unordered_set that gcs uses.
+template <typename T>
+class FlatSet {
+   public:
+    using value_type = T;
+    using iterator = typename std::vector<T>::const_iterator;
+    using const_iterator = iterator;
+
+    FlatSet() = default;
+    FlatSet(std::initializer_list<T> values)
+        : FlatSet(values.begin(), values.end()) {}
+
+    template <typename InputIt>
+    FlatSet(InputIt first, InputIt last) : elements(first, last) {
+        std::sort(elements.begin(), elements.end(), std::less<T>{});
+        elements.erase(std::unique(elements.begin(), elements.end()),
+                       elements.end());
+        elements.shrink_to_fit();
+    }
+
+    iterator begin() const { return elements.begin(); }
+    iterator end() const { return elements.end(); }
+    size_t size() const { return elements.size(); }
+    bool empty() const { return elements.empty(); }
+
+    iterator find(const T& value) const {
+        auto it = lower_bound(value);
+        return it != end() && *it == value ? it : end();
+    }
+    size_t count(const T& value) const { return find(value) != end(); }
+
+    std::pair<iterator, bool> insert(const T& value) {
+        auto it = lower_bound(value);
+        if (it != end() && *it == value) {
+            return {it, false};
+        }
+        return {elements.insert(it, value), true};
+    }
+
+    template <typename InputIt>
+    void insert(InputIt first, InputIt last) {
+        for (; first != last; ++first) {
+            insert(*first);
+        }
+    }
+
+    size_t erase(const T& value) {
+        auto it = find(value);
+        if (it == end()) {
+            return 0;
+        }
+        elements.erase(it);
+        return 1;
+    }
+    iterator erase(iterator it) { return elements.erase(it); }
+
+    void clear() { elements.clear(); }
+    void reserve(size_t n) { elements.reserve(n); }
+
+    bool operator==(const FlatSet& other) const {
+        return elements == other.elements;
+    }
+    bool operator!=(const FlatSet& other) const { return !(*this == other); }
+
+   private:
+    iterator lower_bound(const T& value) const {
+        return std::lower_bound(begin(), end(), value, std::less<T>{});
+    }
+
+    std::vector<T> elements;
+};
+
+}  // namespace gcs
+
+#endif  // GCS_CORE_FLAT_SET
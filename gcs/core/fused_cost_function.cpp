@@ -0,0 +1,139 @@
+#include "gcs/core/fused_cost_function.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace gcs {
+
+FusedCostFunction::FusedCostFunction(std::vector<Term> terms,
+                                     int num_parameters,
+                                     std::vector<Batch> batches)
+    : terms{std::move(terms)}, batches{std::move(batches)} {
+    int num_residuals = 0;
+    for (auto& term : this->terms) {
+        assert(term.indices.size() ==
+                   term.cost_function->parameter_block_sizes().size() &&
+               "Each parameter of a term should have an index");
+
+        num_residuals += term.cost_function->num_residuals();
+        max_parameters = std::max(max_parameters, term.indices.size());
+        max_residuals = std::max<size_t>(max_residuals,
+                                         term.cost_function->num_residuals());
+    }
+    for (auto& batch : this->batches) {
+        assert(batch.num_arguments > 0 &&
+               batch.indices.size() == batch.size() * batch.num_arguments &&
+               batch.constants.size() == batch.indices.size() &&
+               "Each equation of a batch should have every argument");
+
+        num_residuals += batch.size();
+    }
+
+    set_num_residuals(num_residuals);
+    mutable_parameter_block_sizes()->assign(1, num_parameters);
+
+    term_parameters.resize(max_parameters);
+    term_jacobian.resize(max_parameters * max_residuals);
+    term_jacobians.resize(max_parameters);
+
+    batch_buffers.resize(this->batches.size());
+    for (size_t b = 0; b < this->batches.size(); ++b) {
+        const size_t size =
+            this->batches[b].num_arguments * this->batches[b].size();
+        batch_buffers[b].arguments.resize(size);
+        batch_buffers[b].jacobians.resize(size);
+    }
+}
+
+FusedCostFunction::~FusedCostFunction() {
+    for (auto& term : terms) {
+        delete term.cost_function;
+    }
+}
+
+bool FusedCostFunction::Evaluate(double const* const* parameters,
+                                 double* residuals,
+                                 double** jacobians) const {
+    const double* values = parameters[0];
+    const int num_parameters = parameter_block_sizes()[0];
+    double* jacobian = jacobians ? jacobians[0] : nullptr;
+
+    // the jacobian is dense and row major, and each term only fills in the
+    // columns of the parameters it uses
+    if (jacobian) {
+        std::fill(jacobian, jacobian + num_residuals() * num_parameters, 0.0);
+    }
+
+    for (auto& term : terms) {
+        const size_t n = term.indices.size();
+        const int m = term.cost_function->num_residuals();
+
+        for (size_t i = 0; i < n; ++i) {
+            const int index = term.indices[i];
+            term_parameters[i] = index >= 0 ? &values[index] : term.constants[i];
+            term_jacobians[i] =
+                jacobian && index >= 0 ? &term_jacobian[i * m] : nullptr;
+        }
+
+        if (!term.cost_function->Evaluate(term_parameters.data(),
+                                          residuals,
+                                          jacobian ? term_jacobians.data()
+                                                   : nullptr)) {
+            return false;
+        }
+
+        if (jacobian) {
+            for (size_t i = 0; i < n; ++i) {
+                const int index = term.indices[i];
+                if (index < 0) {
+                    continue;
+                }
+                for (int k = 0; k < m; ++k) {
+                    jacobian[k * num_parameters + index] += term_jacobians[i][k];
+                }
+            }
+            jacobian += m * num_parameters;
+        }
+        residuals += m;
+    }
+
+    for (size_t b = 0; b < batches.size(); ++b) {
+        const Batch& batch = batches[b];
+        const size_t count = batch.size();
+        const size_t n = batch.num_arguments;
+        std::vector<double>& arguments = batch_buffers[b].arguments;
+        std::vector<double>& batch_jacobians = batch_buffers[b].jacobians;
+
+        // gather the arguments so that each one is contiguous
+        for (size_t i = 0; i < count; ++i) {
+            for (size_t a = 0; a < n; ++a) {
+                const int index = batch.indices[i * n + a];
+                arguments[a * count + i] =
+                    index >= 0 ? values[index] : *batch.constants[i * n + a];
+            }
+        }
+
+        batch.kernel(count,
+                     arguments.data(),
+                     residuals,
+                     jacobian ? batch_jacobians.data() : nullptr);
+
+        if (jacobian) {
+            for (size_t i = 0; i < count; ++i) {
+                for (size_t a = 0; a < n; ++a) {
+                    const int index = batch.indices[i * n + a];
+                    if (index >= 0) {
+                        jacobian[i * num_parameters + index] +=
+                            batch_jacobians[a * count + i];
+                    }
+                }
+            }
+            jacobian += count * num_parameters;
+        }
+        residuals += count;
+    }
+
+    return true;
+}
+
+}  // namespace gcs
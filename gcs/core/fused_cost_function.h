@@ -0,0 +1,97 @@
+#ifndef GCS_CORE_FUSED_COST_FUNCTION
+#define GCS_CORE_FUSED_COST_FUNCTION
+
+#include <ceres/ceres.h>
+
+#include <vector>
+
+#include "gcs/core/solve_elements.h"
+
+namespace gcs {
+
+//! Cost function that evaluates the residual blocks of a whole equation set
+//! as one residual block with one parameter block
+//!
+//! Ceres has a fixed overhead for each residual block and each parameter
+//! block, which outweighs evaluating the small functions of most constraints.
+//! The variables that an equation set solves for have consecutive slots in
+//! the value store, so they can be passed to ceres as a single parameter
+//! block, while the values that are held constant are read in place.
+//!
+//! Equations that have a batch kernel are evaluated in batches of the same
+//! function instead, after the other residual blocks.
+//!
+//! @see Problem::fuse_residuals
+class FusedCostFunction : public ceres::CostFunction {
+   public:
+    //! A residual block of the equation set
+    struct Term {
+        //! The cost function of the residual block, whose parameter blocks
+        //! must all have size 1 (owned by the fused cost function)
+        const ceres::CostFunction* cost_function;
+        //! Index of each parameter of the cost function in the fused
+        //! parameter block, or -1 if the parameter is held constant
+        std::vector<int> indices;
+        //! Location of each parameter that is held constant (null for the
+        //! other parameters)
+        std::vector<const double*> constants;
+    };
+
+    //! Equations with the same batch kernel, which each have one residual
+    struct Batch {
+        BatchKernel kernel;
+        //! Number of arguments of each equation
+        size_t num_arguments;
+        //! Index of each argument in the fused parameter block, or -1 if the
+        //! argument is held constant, laid out by equation
+        std::vector<int> indices;
+        //! Location of each argument that is held constant (null for the
+        //! other arguments), laid out like indices
+        std::vector<const double*> constants;
+
+        //! @returns the number of equations in this batch
+        size_t size() const { return indices.size() / num_arguments; }
+    };
+
+    //! @param terms the residual blocks to evaluate
+    //! @param num_parameters the size of the fused parameter block
+    //! @param batches the equations to evaluate with batch kernels
+    FusedCostFunction(std::vector<Term> terms,
+                      int num_parameters,
+                      std::vector<Batch> batches = {});
+    ~FusedCostFunction() override;
+
+    FusedCostFunction(const FusedCostFunction&) = delete;
+    FusedCostFunction& operator=(const FusedCostFunction&) = delete;
+
+    bool Evaluate(double const* const* parameters,
+                  double* residuals,
+                  double** jacobians) const override;
+
+   private:
+    std::vector<Term> terms;
+    std::vector<Batch> batches;
+    //! The most parameters and residuals of any term, which size the scratch
+    //! space of Evaluate
+    size_t max_parameters = 0;
+    size_t max_residuals = 0;
+
+    // scratch space for Evaluate, which Ceres doesn't call concurrently for
+    // the same residual block
+    mutable std::vector<const double*> term_parameters;
+    mutable std::vector<double> term_jacobian;
+    mutable std::vector<double*> term_jacobians;
+
+    //! Arguments and jacobians of a batch, laid out by argument for its
+    //! kernel
+    struct BatchBuffers {
+        std::vector<double> arguments;
+        std::vector<double> jacobians;
+    };
+    //! Buffers of each batch, sized in the constructor
+    mutable std::vector<BatchBuffers> batch_buffers;
+};
+
+}  // namespace gcs
+
+#endif  // GCS_CORE_FUSED_COST_FUNCTION
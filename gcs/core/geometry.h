@@ -1,6 +1,7 @@
 #ifndef GCS_CORE_GEOMETRY
 #define GCS_CORE_GEOMETRY
 
+#include <string>
 #include <vector>
 
 #include "gcs/core/solve_elements.h"
@@ -13,12 +14,29 @@ namespace gcs {
 //! struct/class members. The class should have ownership over its variables and
 //! geometry
 struct Geometry {
+    virtual ~Geometry() = default;
+
     //! Get all variables belonging to this object
     //!
     //! Note that this includes variables of sub-components of the geometry
     //!
     //! @returns Pointers to each variable that defines this geometry
     virtual std::vector<Variable*> get_variables() = 0;
+
+    //! Name of this type of geometry, which is used to make it again when a
+    //! problem is loaded (empty if it can't be saved)
+    //! @see TypeRegistry
+    virtual const char* type_name() const { return ""; }
+
+    //! Finds this geometry or one of its sub-components
+    //!
+    //! @param type the type name of the geometry to find
+    //! @param first the first variable of the geometry to find
+    //! @returns the geometry, or null if there is none
+    virtual Geometry* find_geometry(const std::string& type,
+                                    const Variable* first) {
+        return nullptr;
+    }
 };
 
 }  // namespace gcs
@@ -0,0 +1,461 @@
+#include "gcs/core/presolve.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace gcs {
+
+namespace {
+
+//! Union-find over variables that tracks the offset of each variable from its
+//! parent, so that value(var) = value(root) + offset
+//!
+//! Node 0 is the constant zero, which is always kept as the root of its class.
+class AliasForest {
+   public:
+    AliasForest() : parent{0}, offset{0.0}, variables{nullptr} {}
+
+    //! @returns the node of a variable, or of the constant zero for null
+    uint32_t node(Variable* var) {
+        if (var == nullptr) {
+            return 0;
+        }
+
+        auto it = nodes.emplace(var, parent.size());
+        if (it.second) {
+            parent.push_back(parent.size());
+            offset.push_back(0.0);
+            variables.push_back(var);
+        }
+        return it.first->second;
+    }
+
+    //! Finds the root of a node, compressing the path to it
+    //!
+    //! @param n the node
+    //! @param[out] total the offset of the node from the root
+    //! @returns the root node
+    uint32_t find(uint32_t n, double& total) {
+        uint32_t root = n;
+        total = 0.0;
+        while (parent[root] != root) {
+            total += offset[root];
+            root = parent[root];
+        }
+
+        double remaining = total;
+        while (parent[n] != n) {
+            const uint32_t next = parent[n];
+            const double step = offset[n];
+            parent[n] = root;
+            offset[n] = remaining;
+            remaining -= step;
+            n = next;
+        }
+
+        return root;
+    }
+
+    //! Merges the classes of two variables, so that
+    //! value(a) = value(b) + c
+    //!
+    //! @returns false if a and b are already in the same class
+    bool unite(Variable* a, Variable* b, double c) {
+        double offset_a;
+        double offset_b;
+        const uint32_t root_a = find(node(a), offset_a);
+        const uint32_t root_b = find(node(b), offset_b);
+        if (root_a == root_b) {
+            return false;
+        }
+
+        // value(root_a) = value(root_b) + d
+        const double d = offset_b + c - offset_a;
+        if (root_a == 0) {
+            parent[root_b] = 0;
+            offset[root_b] = -d;
+        } else {
+            parent[root_a] = root_b;
+            offset[root_a] = d;
+        }
+        return true;
+    }
+
+    //! @returns true if the variable is fixed by constants
+    bool is_fixed(Variable* var) {
+        double total;
+        return find(node(var), total) == 0;
+    }
+
+    //! @returns the value of a variable that is fixed by constants
+    double fixed_value(Variable* var) {
+        double total;
+        find(node(var), total);
+        return total;
+    }
+
+    std::unordered_map<Variable*, uint32_t> nodes;
+    std::vector<uint32_t> parent;
+    std::vector<double> offset;
+    std::vector<Variable*> variables;
+};
+
+//! @returns the variable of an equation that an argument points to, or null
+//! if the argument is a constant
+Variable* variable_of(const Equation& eq, const double* arg) {
+    for (auto& var : eq.references) {
+        if (&var->value == arg) {
+            return var;
+        }
+    }
+    return nullptr;
+}
+
+//! Recognises an equation that can be eliminated
+bool match(Equation& eq, Presolve::Elimination& elimination) {
+    const auto& args = eq.arguments;
+    elimination = {&eq, nullptr, nullptr, nullptr, nullptr, 1.0};
+
+    if (eq.function == "equate" && args.size() == 2) {
+        auto v1 = variable_of(eq, args[0]);
+        auto v2 = variable_of(eq, args[1]);
+
+        if (v1 && v2) {
+            elimination.a = v1;
+            elimination.b = v2;
+            return v1 != v2;
+        }
+        if (v1 || v2) {
+            elimination.a = v1 ? v1 : v2;
+            elimination.rhs = v1 ? args[1] : args[0];
+            return true;
+        }
+        return false;
+    }
+
+    if (eq.function == "difference" && args.size() == 3) {
+        auto v1 = variable_of(eq, args[0]);
+        auto v2 = variable_of(eq, args[1]);
+        if (!v1 || !v2 || v1 == v2) {
+            return false;
+        }
+
+        // |v1 - v2| = d is linear once the sign of v1 - v2 is fixed
+        elimination.a = v1;
+        elimination.b = v2;
+        elimination.sign = v1->value >= v2->value ? 1.0 : -1.0;
+        elimination.rhs_variable = variable_of(eq, args[2]);
+        if (!elimination.rhs_variable) {
+            elimination.rhs = args[2];
+        }
+        return true;
+    }
+
+    return false;
+}
+
+//! @returns the right hand side of an elimination
+double rhs_value(const Presolve::Elimination& elimination,
+                 AliasForest& forest) {
+    double rhs = 0.0;
+    if (elimination.rhs) {
+        rhs = *elimination.rhs;
+    } else if (elimination.rhs_variable) {
+        rhs = forest.fixed_value(elimination.rhs_variable);
+    }
+    return elimination.sign * rhs;
+}
+
+//! Cost function that evaluates another cost function with some of its
+//! parameters replaced by aliases
+class AliasedCostFunction : public ceres::CostFunction {
+   public:
+    //! A parameter of the wrapped cost function
+    struct Argument {
+        //! Parameter block of this cost function that the parameter is
+        //! relative to, or -1 if the parameter is constant
+        int block;
+        //! Alias the parameter is evaluated through, or null if the parameter
+        //! is the parameter block itself
+        const Alias* alias;
+    };
+
+    AliasedCostFunction(const ceres::CostFunction* cost_function,
+                        std::vector<Argument> arguments,
+                        int num_blocks)
+        : cost_function{cost_function},
+          arguments{std::move(arguments)},
+          values(this->arguments.size()),
+          value_ptrs(this->arguments.size()),
+          arg_jacobians(this->arguments.size() *
+                        cost_function->num_residuals()),
+          arg_jacobian_ptrs(this->arguments.size()) {
+        set_num_residuals(cost_function->num_residuals());
+        mutable_parameter_block_sizes()->assign(num_blocks, 1);
+
+        for (size_t i = 0; i < values.size(); ++i) {
+            value_ptrs[i] = &values[i];
+        }
+    }
+
+    bool Evaluate(double const* const* parameters,
+                  double* residuals,
+                  double** jacobians) const override {
+        const size_t n = arguments.size();
+        const int m = num_residuals();
+
+        for (size_t i = 0; i < n; ++i) {
+            const auto& arg = arguments[i];
+            values[i] = (arg.block >= 0 ? parameters[arg.block][0] : 0.0) +
+                        (arg.alias ? arg.alias->offset : 0.0);
+        }
+
+        if (jacobians == nullptr) {
+            return cost_function->Evaluate(
+                value_ptrs.data(), residuals, nullptr);
+        }
+
+        for (size_t i = 0; i < n; ++i) {
+            const int block = arguments[i].block;
+            arg_jacobian_ptrs[i] = block >= 0 && jacobians[block] != nullptr
+                                       ? &arg_jacobians[i * m]
+                                       : nullptr;
+        }
+
+        if (!cost_function->Evaluate(
+                value_ptrs.data(), residuals, arg_jacobian_ptrs.data())) {
+            return false;
+        }
+
+        // parameters that share a parameter block add up their derivatives
+        const size_t num_blocks = parameter_block_sizes().size();
+        for (size_t b = 0; b < num_blocks; ++b) {
+            if (jacobians[b] != nullptr) {
+                std::fill(jacobians[b], jacobians[b] + m, 0.0);
+            }
+        }
+        for (size_t i = 0; i < n; ++i) {
+            if (arg_jacobian_ptrs[i] == nullptr) {
+                continue;
+            }
+            double* jacobian = jacobians[arguments[i].block];
+            for (int r = 0; r < m; ++r) {
+                jacobian[r] += arg_jacobian_ptrs[i][r];
+            }
+        }
+
+        return true;
+    }
+
+   private:
+    std::unique_ptr<const ceres::CostFunction> cost_function;
+    std::vector<Argument> arguments;
+
+    // scratch space for Evaluate, which Ceres doesn't call concurrently for
+    // the same residual block
+    mutable std::vector<double> values;
+    mutable std::vector<const double*> value_ptrs;
+    mutable std::vector<double> arg_jacobians;
+    mutable std::vector<double*> arg_jacobian_ptrs;
+};
+
+}  // namespace
+
+const Alias* Presolve::find(const double* value) const {
+    auto it = aliases.find(value);
+    return it == aliases.end() ? nullptr : &it->second;
+}
+
+std::vector<Variable*> Presolve::refresh() {
+    // the eliminations are replayed in order, so the classes come out the same
+    AliasForest forest{};
+    for (auto& elimination : eliminations) {
+        forest.unite(elimination.a,
+                     elimination.b,
+                     rhs_value(elimination, forest));
+    }
+
+    std::vector<Variable*> changed{};
+    for (auto& var : variables) {
+        double offset;
+        forest.find(forest.node(var), offset);
+
+        auto& alias = aliases.at(&var->value);
+        if (alias.offset != offset) {
+            alias.offset = offset;
+            changed.push_back(var);
+        }
+    }
+
+    write_back();
+    return changed;
+}
+
+void Presolve::write_back() const {
+    for (auto& var : variables) {
+        var->value = aliases.at(&var->value).value();
+    }
+}
+
+Presolve presolve(const std::vector<Equation*>& equations) {
+    Presolve result{};
+    AliasForest forest{};
+
+    std::vector<Presolve::Elimination> candidates{};
+    for (auto& eq : equations) {
+        Presolve::Elimination elimination;
+        if (match(*eq, elimination)) {
+            candidates.push_back(elimination);
+        }
+    }
+
+    // a "difference" has to wait until its difference is fixed, so keep
+    // sweeping the candidates while that makes progress
+    std::vector<bool> done(candidates.size(), false);
+    for (bool progress = true; progress;) {
+        progress = false;
+
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            const auto& elimination = candidates[i];
+            if (done[i] || (elimination.rhs_variable &&
+                            !forest.is_fixed(elimination.rhs_variable))) {
+                continue;
+            }
+
+            // an equation within a single class is kept, since it's either
+            // redundant or conflicting
+            done[i] = true;
+            if (forest.unite(elimination.a,
+                             elimination.b,
+                             rhs_value(elimination, forest))) {
+                result.eliminations.push_back(elimination);
+                result.eliminated.insert(elimination.equation);
+                progress = true;
+            }
+        }
+    }
+
+    // every variable that isn't the root of its class is aliased to the root
+    for (uint32_t n = 1; n < forest.variables.size(); ++n) {
+        double offset;
+        const uint32_t root = forest.find(n, offset);
+        if (root == n) {
+            continue;
+        }
+
+        auto var = forest.variables[n];
+        result.variables.push_back(var);
+        result.aliases.emplace(
+            &var->value,
+            Alias{root == 0 ? nullptr : forest.variables[root], offset});
+    }
+
+    // rewire the remaining equations to the roots
+    for (auto& eq : equations) {
+        for (auto& var : eq->variables) {
+            var->equations.erase(eq);
+        }
+        eq->variables.clear();
+
+        if (result.eliminated.find(eq) != result.eliminated.end()) {
+            continue;
+        }
+
+        for (auto& var : eq->references) {
+            auto alias = result.find(&var->value);
+            if (alias == nullptr) {
+                eq->variables.insert(var);
+                var->equations.insert(eq);
+                continue;
+            }
+
+            result.users[var].push_back(eq);
+            if (alias->representative) {
+                eq->variables.insert(alias->representative);
+                alias->representative->equations.insert(eq);
+            }
+        }
+    }
+
+    result.write_back();
+    return result;
+}
+
+void add_residual(const Equation& equation,
+                  ceres::Problem& problem,
+                  const Presolve* presolved,
+                  ValueStore* values) {
+    if (!presolved && !values) {
+        equation.make_residual_ftor(problem);
+        return;
+    }
+
+    // let the equation make its residual block in a scratch problem that
+    // doesn't own the cost function (equations don't use loss functions)
+    ceres::Problem::Options options{};
+    options.cost_function_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
+    options.loss_function_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
+    ceres::Problem scratch{options};
+    equation.make_residual_ftor(scratch);
+
+    std::vector<ceres::ResidualBlockId> residual_blocks{};
+    scratch.GetResidualBlocks(&residual_blocks);
+
+    for (auto& residual_block : residual_blocks) {
+        auto cost_function =
+            scratch.GetCostFunctionForResidualBlock(residual_block);
+        std::vector<double*> blocks{};
+        scratch.GetParameterBlocksForResidualBlock(residual_block, &blocks);
+
+        std::vector<AliasedCostFunction::Argument> arguments{};
+        std::vector<double*> new_blocks{};
+        bool aliased = false;
+
+        for (auto& block : blocks) {
+            auto alias = presolved ? presolved->find(block) : nullptr;
+            double* new_block = block;
+            if (alias) {
+                aliased = true;
+                new_block = alias->representative
+                                ? &alias->representative->value
+                                : nullptr;
+            }
+            if (new_block && values) {
+                auto slot = values->find(new_block);
+                new_block = slot ? slot : new_block;
+            }
+
+            int index = -1;
+            if (new_block) {
+                auto it =
+                    std::find(new_blocks.begin(), new_blocks.end(), new_block);
+                index = it - new_blocks.begin();
+                if (it == new_blocks.end()) {
+                    new_blocks.push_back(new_block);
+                }
+            }
+            arguments.push_back({index, alias});
+        }
+
+        if (!aliased) {
+            // a residual block never uses a parameter block twice, so the new
+            // blocks are in the same order as the old ones
+            problem.AddResidualBlock(
+                const_cast<ceres::CostFunction*>(cost_function),
+                nullptr,
+                new_blocks);
+        } else if (new_blocks.empty()) {
+            // only uses fixed variables, so the residual can't change
+            delete cost_function;
+        } else {
+            const int num_blocks = new_blocks.size();
+            problem.AddResidualBlock(
+                new AliasedCostFunction{
+                    cost_function, std::move(arguments), num_blocks},
+                nullptr,
+                new_blocks);
+        }
+    }
+}
+
+}  // namespace gcs
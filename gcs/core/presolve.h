@@ -0,0 +1,111 @@
+#ifndef GCS_CORE_PRESOLVE
+#define GCS_CORE_PRESOLVE
+
+#include <ceres/ceres.h>
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "gcs/core/solve_elements.h"
+#include "gcs/core/value_store.h"
+
+namespace gcs {
+
+//! The value of an eliminated variable, in terms of a variable that is still
+//! solved for
+//!
+//! The value is representative->value + offset, or just offset if the
+//! variable is fixed by constants (the representative is null).
+struct Alias {
+    Variable* representative = nullptr;
+    double offset = 0.0;
+
+    //! @returns the current value of the aliased variable
+    double value() const {
+        return representative ? representative->value + offset : offset;
+    }
+};
+
+//! Result of eliminating linear "equate" and "difference" equations by
+//! aliasing their variables
+//!
+//! @see presolve
+struct Presolve {
+    //! An eliminated equation, which states that
+    //! a->value = b->value + sign * rhs, where b is null for a constant and rhs
+    //! is either a constant or a variable fixed by earlier eliminations
+    struct Elimination {
+        Equation* equation;
+        Variable* a;
+        Variable* b;
+        const double* rhs;
+        Variable* rhs_variable;
+        double sign;
+    };
+
+    //! The eliminated equations, in the order they were applied
+    std::vector<Elimination> eliminations;
+    //! The eliminated equations, for lookup
+    std::unordered_set<const Equation*> eliminated;
+    //! The eliminated variables
+    std::vector<Variable*> variables;
+    //! The alias of each eliminated variable, by the address of its value
+    std::unordered_map<const double*, Alias> aliases;
+    //! The remaining equations that use each eliminated variable
+    std::unordered_map<Variable*, std::vector<Equation*>> users;
+
+    //! @returns the alias of a variable value, or null if the variable wasn't
+    //! eliminated
+    const Alias* find(const double* value) const;
+
+    //! Recomputes the offsets of all aliases from the current constants (such
+    //! as after the value of a SetConstant changes) and writes back the values
+    //! of the eliminated variables
+    //!
+    //! @returns the eliminated variables whose offset changed
+    std::vector<Variable*> refresh();
+
+    //! Sets the value of each eliminated variable from its alias
+    void write_back() const;
+};
+
+//! Eliminates linear "equate" and "difference" equations before splitting
+//!
+//! Each eliminated equation merges the variables it relates with a union-find
+//! that tracks the offset of every variable from the root of its class.
+//! Constants (such as the value of a SetConstant) ground a class, so all of
+//! its variables become fixed. A "difference" is only eliminated once its
+//! difference is fixed, and the sign of the difference is taken from the
+//! current values. Equations that relate variables that are already in the
+//! same class are kept, so conflicts are still found by splitting.
+//!
+//! The eliminated equations are removed from the graph, and the remaining
+//! equations are rewired to use the root of each class in place of the
+//! eliminated variables (fixed variables are dropped as they're constant).
+//!
+//! @param equations all equations of the problem
+//! @returns the eliminated equations and the aliases of the eliminated
+//! variables
+Presolve presolve(const std::vector<Equation*>& equations);
+
+//! Adds the residual block of an equation to a ceres problem, evaluating the
+//! eliminated variables through their aliases and using the slots of a value
+//! store as parameter blocks
+//!
+//! Residual blocks that don't use an eliminated variable are added with the
+//! same cost function.
+//!
+//! @param equation an equation that wasn't eliminated
+//! @param problem the ceres problem, which takes ownership of the cost function
+//! @param presolved aliases of the eliminated variables, if any
+//! @param values the value store to use for the parameter blocks, if any
+//! (values that aren't in the store are used in place)
+void add_residual(const Equation& equation,
+                  ceres::Problem& problem,
+                  const Presolve* presolved,
+                  ValueStore* values);
+
+}  // namespace gcs
+
+#endif  // GCS_CORE_PRESOLVE
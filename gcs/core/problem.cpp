@@ -1,48 +1,191 @@
 #include "gcs/core/problem.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "gcs/core/dependency_graph.h"
+#include "gcs/core/direct_solve.h"
+#include "gcs/core/fused_cost_function.h"
+#include "gcs/core/presolve.h"
 #include "gcs/core/split_equation_sets.h"
 
-ceres::Solver::Summary gcs::single_solve(EquationSet& eqn_set) {
-    ceres::Problem problem = {};
+gcs::SolverContext::SolverContext(EquationSet& eqn_set,
+                                  const Presolve* presolved,
+                                  ValueStore* values,
+                                  bool fuse) {
+    // let the equations make their residual blocks in a scratch problem that
+    // doesn't own the cost functions (equations don't use loss functions)
+    ceres::Problem::Options scratch_options{};
+    scratch_options.cost_function_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
+    scratch_options.loss_function_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
+    ceres::Problem scratch{scratch_options};
 
-    // add all residual blocks
+    // equations with a batch kernel are held back, to be evaluated in batches
+    // if the residuals are fused (equations that use an eliminated variable
+    // are evaluated through its alias instead)
+    std::vector<Equation*> batched{};
+    auto aliased = [&](const double* arg) {
+        return presolved && presolved->find(arg);
+    };
     for (auto& eqn : eqn_set.equations) {
-        eqn->make_residual_ftor(problem);
+        if (fuse && values && eqn->batch_kernel &&
+            std::none_of(
+                eqn->arguments.begin(), eqn->arguments.end(), aliased)) {
+            batched.push_back(eqn);
+        } else {
+            add_residual(*eqn, scratch, presolved, values);
+        }
     }
 
-    // hold parameter blocks constant if necessary
+    std::vector<ceres::ResidualBlockId> residual_blocks{};
+    scratch.GetResidualBlocks(&residual_blocks);
+
+    // find the parameter blocks that the equation set solves for
     std::unordered_set<double*> variable_parameter_blocks = {};
+    bool in_store = values != nullptr;
     for (auto& var : eqn_set.get_variables()) {
-        variable_parameter_blocks.insert(&var->value);
+        auto slot = values ? values->find(&var->value) : nullptr;
+        variable_parameter_blocks.insert(slot ? slot : &var->value);
+        in_store = in_store && slot;
+    }
+
+    // the solved values can be fused into one parameter block if they fill a
+    // range of slots, which is the case unless the equation set was re-split
+    // since the values were laid out
+    double* first = nullptr;
+    if (fuse && in_store && !variable_parameter_blocks.empty()) {
+        first = *std::min_element(variable_parameter_blocks.begin(),
+                                  variable_parameter_blocks.end());
+        for (auto block : variable_parameter_blocks) {
+            if (static_cast<size_t>(block - first) >=
+                variable_parameter_blocks.size()) {
+                first = nullptr;
+                break;
+            }
+        }
+    }
+    for (auto& residual_block : residual_blocks) {
+        auto cost_function =
+            scratch.GetCostFunctionForResidualBlock(residual_block);
+        for (auto size : cost_function->parameter_block_sizes()) {
+            if (size != 1) {
+                first = nullptr;
+            }
+        }
     }
 
-    std::vector<double*> all_parameter_blocks = {};
-    problem.GetParameterBlocks(&all_parameter_blocks);
+    if (!first && !batched.empty()) {
+        for (auto& eqn : batched) {
+            add_residual(*eqn, scratch, presolved, values);
+        }
+        batched.clear();
+        scratch.GetResidualBlocks(&residual_blocks);
+    }
+
+    if (first) {
+        std::vector<FusedCostFunction::Term> terms{};
+        for (auto& residual_block : residual_blocks) {
+            FusedCostFunction::Term term{
+                scratch.GetCostFunctionForResidualBlock(residual_block),
+                {},
+                {}};
+            std::vector<double*> blocks{};
+            scratch.GetParameterBlocksForResidualBlock(residual_block, &blocks);
+
+            for (auto block : blocks) {
+                bool variable = variable_parameter_blocks.count(block) > 0;
+                term.indices.push_back(variable ? block - first : -1);
+                term.constants.push_back(variable ? nullptr : block);
+            }
+            terms.push_back(std::move(term));
+        }
+
+        std::vector<FusedCostFunction::Batch> batches{};
+        for (auto& eqn : batched) {
+            auto batch = std::find_if(
+                batches.begin(),
+                batches.end(),
+                [&](const FusedCostFunction::Batch& batch) {
+                    return batch.kernel == eqn->batch_kernel;
+                });
+            if (batch == batches.end()) {
+                batches.push_back(
+                    {eqn->batch_kernel, eqn->arguments.size(), {}, {}});
+                batch = batches.end() - 1;
+            }
+
+            for (auto arg : eqn->arguments) {
+                auto slot = values->find(arg);
+                bool variable = slot && variable_parameter_blocks.count(slot);
+                batch->indices.push_back(variable ? slot - first : -1);
+                batch->constants.push_back(
+                    variable ? nullptr : (slot ? slot : arg));
+            }
+        }
+
+        problem.AddResidualBlock(
+            new FusedCostFunction{
+                std::move(terms),
+                static_cast<int>(variable_parameter_blocks.size()),
+                std::move(batches)},
+            nullptr,
+            first);
+    } else {
+        // add all residual blocks
+        for (auto& residual_block : residual_blocks) {
+            auto cost_function = const_cast<ceres::CostFunction*>(
+                scratch.GetCostFunctionForResidualBlock(residual_block));
+            std::vector<double*> blocks{};
+            scratch.GetParameterBlocksForResidualBlock(residual_block, &blocks);
+            problem.AddResidualBlock(cost_function, nullptr, blocks);
+        }
+
+        // hold parameter blocks constant if necessary
+        std::vector<double*> all_parameter_blocks = {};
+        problem.GetParameterBlocks(&all_parameter_blocks);
 
-    for (auto param_block : all_parameter_blocks) {
-        if (variable_parameter_blocks.find(param_block) ==
-            variable_parameter_blocks.end()) {
-            // parameter block isn't variable
-            problem.AddParameterBlock(param_block, 1);
-            problem.SetParameterBlockConstant(param_block);
+        for (auto param_block : all_parameter_blocks) {
+            if (variable_parameter_blocks.find(param_block) ==
+                variable_parameter_blocks.end()) {
+                // parameter block isn't variable
+                problem.SetParameterBlockConstant(param_block);
+            }
         }
     }
 
     // apply settings
-    ceres::Solver::Options options = {};
     options.linear_solver_type = ceres::LinearSolverType::DENSE_QR;
-    options.minimizer_progress_to_stdout = true;
+    options.minimizer_progress_to_stdout = false;
+}
+
+ceres::Solver::Summary gcs::single_solve(EquationSet& eqn_set) {
+    SolverContext context{eqn_set};
+    return single_solve(context);
+}
 
-    // solve
+ceres::Solver::Summary gcs::single_solve(SolverContext& context) {
     ceres::Solver::Summary summary;
-    ceres::Solve(options, &problem, &summary);
+    ceres::Solve(context.options, &context.problem, &summary);
     return summary;
 }
 
 gcs::Problem::~Problem() {
-    for (auto eq : equation_sets) {
-        delete eq;
-    }
+    // the variables belong to the geometry, which can outlive the problem, so
+    // detach them from the equations before the arena destroys them. The
+    // solver contexts also refer to the equations
+    arena.equations.for_each([](Equation& eq) {
+        for (auto& var : eq.references) {
+            var->equations.clear();
+        }
+    });
+    solver_contexts.clear();
 }
 
 template <>
@@ -66,35 +209,18 @@ bool gcs::Problem::add_variable(Variable* var) {
 }
 
 bool gcs::Problem::add_constraint(Constraint* constraint) {
-    constraints.insert(constraint);
-
-    reset_to_single_equation_set();
-
-    // for (auto& eq : constraint->get_equations()) {
-    //     equations.push_back(std::move(eq));
-    //     auto eq2 = &equations.back();
-
-    //     for (auto& var : eq2->variables) {
-    //         add_variable(var);
-    //     }
-
-    //     bool added = false;
-    //     for (auto& eqn_set : equation_sets) {
-    //         if (!eqn_set->is_constrained()) {
-    //             eqn_set->add_equation(*eq2);
-    //             added = true;
-    //         }
-    //     }
-    //     if (!added) {
-    //         auto eqn_set = new EquationSet{};
-    //         equation_sets.insert(eqn_set);
-    //         eqn_set->add_equation(*eq2);
-    //         added = true;
-    //     }
-    // }
-
-    split();
-    solve();
+    if (!constraints.insert(constraint).second) {
+        return false;
+    }
+
+    // adding a constraint back cancels out an earlier removal
+    if (pending_removed.erase(constraint) == 0) {
+        pending_added.insert(constraint);
+    }
+
+    if (edit_depth == 0) {
+        apply_edits();
+    }
 
     return true;
 }
@@ -127,10 +253,19 @@ bool gcs::Problem::remove_variable(Variable* var) {
 }
 
 bool gcs::Problem::remove_constraint(Constraint* constraint) {
-    constraints.erase(constraint);
-    reset_to_single_equation_set();
-    split();
-    solve();
+    if (constraints.erase(constraint) == 0) {
+        return false;
+    }
+
+    // removing a constraint that was never applied cancels out the addition
+    if (pending_added.erase(constraint) == 0) {
+        pending_removed.insert(constraint);
+    }
+
+    if (edit_depth == 0) {
+        apply_edits();
+    }
+
     return true;
 }
 
@@ -139,143 +274,1262 @@ bool gcs::Problem::remove_geometry(Geometry* geom) {
     return true;
 }
 
+gcs::Problem::EditScope::EditScope(Problem& problem) : problem{problem} {
+    problem.begin_edit();
+}
+
+gcs::Problem::EditScope::~EditScope() { problem.commit_edit(); }
+
+void gcs::Problem::begin_edit() { ++edit_depth; }
+
+void gcs::Problem::commit_edit(size_t pool_size) {
+    assert(edit_depth > 0 && "commit_edit called without begin_edit");
+
+    if (--edit_depth == 0) {
+        apply_edits(pool_size);
+    }
+}
+
+void gcs::Problem::apply_edits(size_t pool_size) {
+    if (pending_added.empty() && pending_removed.empty()) {
+        return;
+    }
+
+    TraceSpan span{tracer.get(), "apply edits", "edit"};
+
+    if (!incremental || use_presolve) {
+        for (auto& constraint : pending_removed) {
+            constraint_equations.erase(constraint);
+        }
+        pending_added.clear();
+        pending_removed.clear();
+
+        reset_to_single_equation_set();
+        split();
+        solve(pool_size);
+        return;
+    }
+
+    std::vector<Equation*> added{};
+    std::vector<Equation*> removed{};
+
+    for (auto& constraint : pending_added) {
+        auto& eqns = constraint_equations[constraint];
+        eqns = constraint->get_equations(arena);
+        added.insert(added.end(), eqns.begin(), eqns.end());
+    }
+    for (auto& constraint : pending_removed) {
+        auto& eqns = constraint_equations[constraint];
+        removed.insert(removed.end(), eqns.begin(), eqns.end());
+        constraint_equations.erase(constraint);
+    }
+    pending_added.clear();
+    pending_removed.clear();
+
+    solve(resplit(added, removed), pool_size);
+}
+
 void gcs::Problem::reset_to_single_equation_set() {
-    for (auto& eqs : equation_sets) {
-        for (auto& var : eqs->get_variables()) {
+    TraceSpan span{tracer.get(), "reset to single equation set", "split"};
+
+    // detach every equation (including removed and eliminated ones) from its
+    // variables before the equations are destroyed
+    arena.equations.for_each([](Equation& eq) {
+        for (auto& var : eq.references) {
             var->equations.clear();
         }
-        delete eqs;
-    }
+    });
+    solver_contexts.clear();
+    arena.clear();
+
     equation_sets.clear();
+    dirty_sets.clear();
+    containing_set.clear();
+    solved_by.clear();
+    constraint_equations.clear();
+    pending_added.clear();
+    pending_removed.clear();
 
-    auto eqn_set = new EquationSet{};
+    auto eqn_set = arena.equation_sets.make();
     equation_sets.insert(eqn_set);
 
+    std::vector<Equation*> all_equations{};
     for (auto& constraint : constraints) {
-        for (auto& eq : constraint->get_equations()) {
+        auto& eqns = constraint_equations[constraint];
+        eqns = constraint->get_equations(arena);
+        all_equations.insert(all_equations.end(), eqns.begin(), eqns.end());
+    }
+
+    TraceSpan presolve_span{tracer.get(), "presolve", "split"};
+    presolved = use_presolve ? presolve(all_equations) : Presolve{};
+    presolve_span.end();
+
+    for (auto& eq : all_equations) {
+        if (presolved.eliminated.find(eq) == presolved.eliminated.end()) {
             eqn_set->add_equation(*eq);
         }
     }
+    index_equation_set(eqn_set);
+
     prereqs.clear();
+    is_prereq_of.clear();
     prereqs.emplace(eqn_set, decltype(prereqs)::mapped_type{});
     is_prereq_of.emplace(eqn_set, decltype(is_prereq_of)::mapped_type{});
+
+    lay_out_values();
 }
 
-void gcs::Problem::split() {
+void gcs::Problem::split(SplitMethod method) {
+    TraceSpan span{tracer.get(), "split", "split"};
+
     auto old_equation_sets = equation_sets;
     equation_sets.clear();
+    solver_contexts.clear();
+    dirty_sets.clear();
     prereqs.clear();
     is_prereq_of.clear();
+    containing_set.clear();
+    solved_by.clear();
+
+    // when a single equation set is decomposed, the dependencies come
+    // straight from the decomposition
+    const bool use_decomposition_dag =
+        method == SplitMethod::block_triangular &&
+        old_equation_sets.size() == 1;
 
     for (auto& eq : old_equation_sets) {
-        auto split_sets = gcs::split(*eq);
-        delete eq;
+        Decomposition decomposition{};
+        if (method == SplitMethod::block_triangular) {
+            decomposition = gcs::decompose(*eq, tracer.get());
+        } else {
+            decomposition.equation_sets =
+                gcs::split(*eq, method, tracer.get());
+        }
+        arena.equation_sets.destroy(eq);
 
-        for (auto& eq2 : split_sets) {
-            auto eq3 = new EquationSet{std::move(eq2)};
+        std::vector<EquationSet*> new_sets{};
+        for (auto& eq2 : decomposition.equation_sets) {
+            auto eq3 = arena.equation_sets.make(std::move(eq2));
             equation_sets.insert(eq3);
             prereqs.emplace(eq3, decltype(prereqs)::mapped_type{});
             is_prereq_of.emplace(eq3, decltype(is_prereq_of)::mapped_type{});
+            index_equation_set(eq3);
+            new_sets.push_back(eq3);
+        }
+
+        if (use_decomposition_dag) {
+            for (size_t i = 0; i < new_sets.size(); ++i) {
+                for (auto j : decomposition.prereqs[i]) {
+                    prereqs[new_sets[i]].insert(new_sets[j]);
+                    is_prereq_of[new_sets[j]].insert(new_sets[i]);
+                }
+            }
         }
     }
 
-    // which equation set does each equation belong to (TODO: track this in
-    // the equation object?)
-    std::unordered_map<Equation*, EquationSet*> containing_set = {};
+    // variables eliminated by presolve are solved along with the variable they
+    // are aliased to
+    for (auto& var : presolved.variables) {
+        auto rep = presolved.find(&var->value)->representative;
+        auto it = solved_by.find(rep);
+        if (it != solved_by.end()) {
+            solved_by[var] = it->second;
+        }
+    }
 
-    for (auto& eqn_set : equation_sets) {
+    // fill out the dependencies/prereqs between equation sets
+    if (!use_decomposition_dag) {
+        TraceSpan link_span{tracer.get(), "link equation sets", "split"};
+        for (auto& eqn_set : equation_sets) {
+            link_equation_set(eqn_set);
+        }
+    }
+
+    lay_out_values();
+}
+
+std::unordered_set<gcs::EquationSet*> gcs::Problem::resplit(
+    const std::vector<Equation*>& added,
+    const std::vector<Equation*>& removed) {
+    TraceSpan span{tracer.get(), "resplit", "split"};
+
+    // find the equation sets that are directly affected by the change
+    std::unordered_set<EquationSet*> affected{};
+
+    for (auto& eq : added) {
+        for (auto& var : eq->references) {
+            auto it = solved_by.find(var);
+            if (it != solved_by.end()) {
+                affected.insert(it->second);
+            }
+        }
+    }
+    for (auto& eq : removed) {
+        auto it = containing_set.find(eq);
+        if (it != containing_set.end()) {
+            affected.insert(it->second);
+        }
+    }
+
+    // an added equation may take up a degree of freedom from an
+    // under-constrained equation set further upstream, which changes how
+    // every equation set in between is solved
+    if (!added.empty()) {
+        std::unordered_set<EquationSet*> ancestors{};
+        std::vector<EquationSet*> stack{affected.begin(), affected.end()};
+        while (!stack.empty()) {
+            auto eqn_set = stack.back();
+            stack.pop_back();
+
+            for (auto& pre : prereqs[eqn_set]) {
+                if (ancestors.insert(pre).second) {
+                    stack.push_back(pre);
+                }
+            }
+        }
+
+        std::unordered_set<EquationSet*> between{};
+        for (auto& eqn_set : ancestors) {
+            if (eqn_set->degrees_of_freedom() > 0) {
+                between.insert(eqn_set);
+                stack.push_back(eqn_set);
+            }
+        }
+        while (!stack.empty()) {
+            auto eqn_set = stack.back();
+            stack.pop_back();
+
+            for (auto& dep : is_prereq_of[eqn_set]) {
+                if (ancestors.find(dep) != ancestors.end() &&
+                    between.insert(dep).second) {
+                    stack.push_back(dep);
+                }
+            }
+        }
+
+        affected.insert(between.begin(), between.end());
+    }
+
+    // anything downstream of an affected equation set is affected too, since
+    // the variables it holds constant may now be solved differently
+    add_dependents(affected);
+
+    // detach the removed equations from their variables
+    std::unordered_set<Equation*> removed_set{removed.begin(), removed.end()};
+    for (auto& eq : removed) {
+        for (auto& var : eq->references) {
+            var->equations.erase(eq);
+        }
+        containing_set.erase(eq);
+    }
+
+    // gather the equations that need to be split again
+    EquationSet region{};
+    for (auto& eqn_set : affected) {
         for (auto& eq : eqn_set->equations) {
-            containing_set.emplace(eq, eqn_set);
+            if (removed_set.find(eq) == removed_set.end()) {
+                region.add_equation(*eq);
+            }
+        }
+    }
+    for (auto& eq : added) {
+        region.add_equation(*eq);
+    }
+
+    // variables solved by the affected equation sets are free again, while
+    // variables solved by unaffected equation sets stay constant
+    auto is_constant = [&](Variable* var) {
+        auto it = solved_by.find(var);
+        return it != solved_by.end() &&
+               affected.find(it->second) == affected.end();
+    };
+
+    for (auto& eq : region.equations) {
+        for (auto& var : eq->references) {
+            if (!is_constant(var)) {
+                var->equations.clear();
+            }
         }
     }
+    for (auto& eq : region.equations) {
+        eq->variables.clear();
 
-    // fill out the dependencies/prereqs between equation sets
-    for (auto& eqn_set : equation_sets) {
-        // from EquationSet::set_solved():
-        //   at the end, a variable will point to equations that require it
-        //   in order to be solved and an equation will point to the
-        //   variables it solves for
+        for (auto& var : eq->references) {
+            var->equations.insert(eq);
+            if (!is_constant(var)) {
+                eq->variables.insert(var);
+            }
+        }
+    }
+
+    // drop the affected equation sets
+    for (auto& eqn_set : affected) {
+        for (auto& pre : prereqs[eqn_set]) {
+            if (affected.find(pre) == affected.end()) {
+                is_prereq_of[pre].erase(eqn_set);
+            }
+        }
+        prereqs.erase(eqn_set);
+        is_prereq_of.erase(eqn_set);
+        equation_sets.erase(eqn_set);
+        solver_contexts.erase(eqn_set);
+        dirty_sets.erase(eqn_set);
+        arena.equation_sets.destroy(eqn_set);
+    }
+    for (auto it = solved_by.begin(); it != solved_by.end();) {
+        if (affected.find(it->second) != affected.end()) {
+            it = solved_by.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    for (auto& eq : removed) {
+        arena.equations.destroy(eq);
+    }
+
+    // split the gathered equations and patch them into the graph
+    std::unordered_set<EquationSet*> new_sets{};
+
+    for (auto& eq2 :
+         gcs::split(region, SplitMethod::block_triangular, tracer.get())) {
+        auto eq3 = arena.equation_sets.make(std::move(eq2));
+        equation_sets.insert(eq3);
+        prereqs.emplace(eq3, decltype(prereqs)::mapped_type{});
+        is_prereq_of.emplace(eq3, decltype(is_prereq_of)::mapped_type{});
+        index_equation_set(eq3);
+        new_sets.insert(eq3);
+    }
+
+    for (auto& eqn_set : new_sets) {
+        link_equation_set(eqn_set);
+    }
 
+    // the variables of added equations are appended to the value store, and
+    // if that moves the store, the compiled ceres problems of the unaffected
+    // equation sets point at the old values
+    const double* old_values = values.data();
+    for (auto& eqn_set : new_sets) {
         for (auto& var : eqn_set->get_variables()) {
-            // var is solved by this equation set
-            for (auto& eq : var->equations) {
-                // eq needs var to be calculated in order to be solvable
-                // so the eqn set that uses eq has this eqn set as a dep
-                auto dep_eqn_set = containing_set[eq];
-                assert(eqn_set->equations.find(eq) == eqn_set->equations.end());
-                assert(dep_eqn_set != eqn_set);
+            values.add(var);
+        }
+    }
+    for (auto& eq : added) {
+        for (auto& var : eq->references) {
+            values.add(var);
+        }
+    }
+    if (values.data() != old_values) {
+        solver_contexts.clear();
+    }
+
+    return new_sets;
+}
+
+bool gcs::Problem::mark_dirty(Variable* var) {
+    bool found = false;
+
+    auto it = solved_by.find(var);
+    if (it != solved_by.end()) {
+        dirty_sets.insert(it->second);
+        found = true;
+    }
+
+    // equations that use var through its alias
+    auto users = presolved.users.find(var);
+    if (users != presolved.users.end()) {
+        for (auto& eq : users->second) {
+            dirty_sets.insert(containing_set.at(eq));
+        }
+        found = true;
+    }
+
+    // equations that hold var constant
+    for (auto& eq : var->equations) {
+        auto it2 = containing_set.find(eq);
+        if (it2 != containing_set.end()) {
+            dirty_sets.insert(it2->second);
+            found = true;
+        }
+    }
+
+    return found;
+}
 
-                // if (dep_eqn_set == eqn_set) {
-                //     continue;
-                // }
+bool gcs::Problem::mark_dirty(Constraint* constraint) {
+    auto it = constraint_equations.find(constraint);
+    if (it == constraint_equations.end()) {
+        return false;
+    }
+
+    bool found = false;
+    bool eliminated = false;
+    for (auto& eq : it->second) {
+        if (presolved.eliminated.find(eq) != presolved.eliminated.end()) {
+            eliminated = true;
+        }
+
+        auto it2 = containing_set.find(eq);
+        if (it2 != containing_set.end()) {
+            dirty_sets.insert(it2->second);
+            found = true;
+        }
+    }
 
-                prereqs[dep_eqn_set].insert(eqn_set);
-                is_prereq_of[eqn_set].insert(dep_eqn_set);
+    if (eliminated) {
+        // the constraint was folded into the aliases, so the equations that
+        // use a variable whose alias moved have to be solved again
+        for (auto& var : presolved.refresh()) {
+            mark_dirty(var);
+        }
+        found = true;
+    }
+
+    return found;
+}
+
+gcs::SolveResult gcs::Problem::solve_dirty(size_t pool_size,
+                                           SchedulePolicy policy) {
+    std::unordered_set<EquationSet*> targets{};
+    std::swap(targets, dirty_sets);
+
+    add_dependents(targets);
+    return solve(targets, pool_size, policy);
+}
+
+namespace {
+
+//! Orders the samples of a sweep so that each sample is close to the one
+//! before it
+//!
+//! @param start the current parameter values
+//! @param samples the parameter values of each sample, stored by sample
+//! @returns the indices of the samples, in the order to solve them
+std::vector<size_t> nearest_neighbour_order(const std::vector<double>& start,
+                                            const std::vector<double>& samples) {
+    const auto num_parameters = start.size();
+    const auto num_samples = samples.size() / num_parameters;
+
+    // scale each parameter by its range, so units don't matter
+    std::vector<double> scale(num_parameters, 1.0);
+    for (size_t j = 0; j < num_parameters; ++j) {
+        double lo = start[j];
+        double hi = start[j];
+        for (size_t i = 0; i < num_samples; ++i) {
+            lo = std::min(lo, samples[i * num_parameters + j]);
+            hi = std::max(hi, samples[i * num_parameters + j]);
+        }
+        if (hi > lo) {
+            scale[j] = 1.0 / (hi - lo);
+        }
+    }
+
+    std::vector<size_t> order{};
+    order.reserve(num_samples);
+    std::vector<bool> done(num_samples, false);
+    const double* current = start.data();
+
+    for (size_t k = 0; k < num_samples; ++k) {
+        size_t nearest = 0;
+        double nearest_distance = std::numeric_limits<double>::infinity();
+
+        for (size_t i = 0; i < num_samples; ++i) {
+            if (done[i]) {
+                continue;
+            }
+
+            double distance = 0.0;
+            for (size_t j = 0; j < num_parameters; ++j) {
+                double delta =
+                    (samples[i * num_parameters + j] - current[j]) * scale[j];
+                distance += delta * delta;
+            }
+            if (distance < nearest_distance) {
+                nearest = i;
+                nearest_distance = distance;
             }
         }
+
+        done[nearest] = true;
+        order.push_back(nearest);
+        current = &samples[nearest * num_parameters];
     }
+
+    return order;
 }
 
-void gcs::Problem::solve(size_t pool_size) {
-    if (pool_size == 0) {
-        pool_size = std::thread::hardware_concurrency();
+//! Solves a single equation set in a value store, in closed form if possible
+//!
+//! @param context the compiled ceres problem of the equation set, which is
+//! made on first use
+//! @param record receives how the equation set was solved
+//! @returns false if ceres didn't converge
+bool solve_equation_set(const gcs::Problem& problem,
+                        gcs::EquationSet& eqn_set,
+                        const gcs::Presolve* aliases,
+                        gcs::ValueStore& values,
+                        gcs::uptr<gcs::SolverContext>& context,
+                        gcs::SolveRecord& record) {
+    if (problem.use_direct_solve &&
+        gcs::direct_solve(eqn_set, aliases, &values)) {
+        record.direct = true;
+        return true;
     }
-    if (pool_size > equation_sets.size()) {
-        pool_size = equation_sets.size();
+
+    if (!context) {
+        context.reset(new gcs::SolverContext{
+            eqn_set, aliases, &values, problem.fuse_residuals});
     }
+    context->options.minimizer_progress_to_stdout = problem.log_solver_progress;
 
-    // track equation set dependencies as they get solved
-    auto solve_prereqs = prereqs;
-    auto solve_is_prereq_of = is_prereq_of;
-    auto not_solved = equation_sets;
+    auto summary = gcs::single_solve(*context);
+    record.iterations =
+        summary.num_successful_steps + summary.num_unsuccessful_steps;
+    record.initial_cost = summary.initial_cost;
+    record.final_cost = summary.final_cost;
+    record.termination_type = summary.termination_type;
+    return summary.termination_type == ceres::CONVERGENCE;
+}
 
-    // set up a thread pool
-    boost::asio::thread_pool pool{pool_size};
-    std::mutex mtx;
+//! The samples of a sweep that are solved in parallel
+//!
+//! The samples are split into chains of neighbouring samples, one per
+//! runner. Each chain solves its samples one after another, in its own copy of
+//! the value store and with its own compiled ceres problems, so each sample is
+//! warm started from the one before it and the chains don't share any values.
+//!
+//! The parameters are owned by the constraints and so are shared by all
+//! chains. A chain holds parameter_mutex from setting the parameters of a
+//! sample until it has solved every equation set that reads them.
+class SweepJob {
+   public:
+    SweepJob(gcs::Problem& problem,
+             const std::vector<gcs::SweepParameter>& parameters,
+             const std::vector<double>& samples,
+             const std::vector<gcs::Variable*>& outputs,
+             const std::unordered_set<gcs::EquationSet*>& parameter_sets,
+             const std::unordered_set<gcs::EquationSet*>& targets,
+             gcs::SweepResult& result)
+        : problem{problem},
+          parameters{parameters},
+          samples{samples},
+          outputs{outputs},
+          result{result},
+          graph{targets, problem.is_prereq_of},
+          order{graph.topological_order()} {
+        // the equation sets that read a parameter come first in the order
+        // unless they depend on other targets, in which case those are
+        // solved while holding the lock too
+        for (size_t k = 0; k < order.size(); ++k) {
+            if (parameter_sets.count(graph.equation_sets[order[k]])) {
+                num_locked = k + 1;
+            }
+        }
+    }
+
+    SweepJob(const SweepJob&) = delete;
+    SweepJob& operator=(const SweepJob&) = delete;
+
+    //! Solves a chain of samples, in order
+    //!
+    //! @param first, last the indices of the samples of the chain
+    void solve_chain(const size_t* first, const size_t* last) {
+        gcs::TraceSpan span{problem.tracer.get(), "sweep chain", "solve"};
+
+        // the chain starts from the current solution
+        gcs::ValueStore values{problem.values};
+        std::vector<gcs::uptr<gcs::SolverContext>> contexts(graph.size());
+        std::vector<double> before{};
 
-    // this function will be passed to the thread pool
-    //
-    // It runs ceres solver on the problem, then updates the active equation
-    // set dependencies. If this update makes it so another equation set
-    // does not depend on anything else, it gets passed to the thread pool
-    // to solve and do the same thing
-    std::function<void(EquationSet*)> solve_func = [&](EquationSet* eqn_set) {
-        single_solve(*eqn_set);
+        const auto num_parameters = parameters.size();
+        for (auto sample = first; sample != last; ++sample) {
+            const auto i = *sample;
+            auto& sample_result = result.results[i];
 
-        // once the equation set has been solved:
-        {
-            std::lock_guard<std::mutex> lock{mtx};
+            if (problem.rollback_on_failure) {
+                values.save(before);
+            }
+
+            auto start = Clock::now();
+            std::unique_lock<std::mutex> lock{parameter_mutex};
+            for (size_t j = 0; j < num_parameters; ++j) {
+                *parameters[j].value = samples[i * num_parameters + j];
+            }
 
-            for (auto& req_by : solve_is_prereq_of[eqn_set]) {
-                // the just-solved equation is no longer holding up
-                // its dependencies
-                solve_prereqs[req_by].erase(eqn_set);
+            for (size_t k = 0; k < order.size(); ++k) {
+                if (k == num_locked) {
+                    lock.unlock();
+                }
+
+                auto& eqn_set = *graph.equation_sets[order[k]];
+                auto eqn_set_start = Clock::now();
+                gcs::SolveRecord record{};
+                if (!solve_equation_set(problem,
+                                        eqn_set,
+                                        nullptr,
+                                        values,
+                                        contexts[order[k]],
+                                        record)) {
+                    ++sample_result.num_failed;
+                }
+                sample_result.num_direct += record.direct;
 
-                // if the dependency isn't waiting on anything
-                // else, it is ready to solve
-                if (solve_prereqs[req_by].size() == 0 &&
-                    not_solved.find(req_by) != not_solved.end()) {
-                    not_solved.erase(eqn_set);
-                    boost::asio::post(pool, std::bind(solve_func, req_by));
+                if (telemetry) {
+                    auto end = Clock::now();
+                    record.eqn_set = &eqn_set;
+                    record.num_equations = eqn_set.equations.size();
+                    record.start_time = seconds(eqn_set_start - start);
+                    record.solve_time = seconds(end - eqn_set_start);
+                    record.thread = std::this_thread::get_id();
+                    sample_result.records.push_back(record);
                 }
             }
+            if (lock.owns_lock()) {
+                lock.unlock();
+            }
+
+            if (sample_result.num_failed > 0 && problem.rollback_on_failure) {
+                values.load(before);
+                sample_result.rolled_back = true;
+            }
+            sample_result.num_equation_sets = graph.size();
+            sample_result.wall_time = seconds(Clock::now() - start);
+
+            for (size_t k = 0; k < outputs.size(); ++k) {
+                auto var = outputs[k];
+                result.values[i * outputs.size() + k] =
+                    values.contains(var) ? values.data()[var->slot]
+                                         : var->value;
+            }
         }
-    };
+    }
+
+   private:
+    using Clock = std::chrono::steady_clock;
+
+    static double seconds(Clock::duration duration) {
+        return std::chrono::duration<double>(duration).count();
+    }
+
+    gcs::Problem& problem;
+    const std::vector<gcs::SweepParameter>& parameters;
+    const std::vector<double>& samples;
+    const std::vector<gcs::Variable*>& outputs;
+    gcs::SweepResult& result;
+
+    //! The equation sets that are solved for each sample
+    const gcs::DependencyGraph graph;
+    //! The ids of the equation sets, in the order they're solved
+    const std::vector<gcs::DependencyGraph::Id> order;
+    //! The number of equation sets at the start of order that are solved
+    //! while holding parameter_mutex
+    size_t num_locked = 0;
+    std::mutex parameter_mutex;
+
+    //! True if records are kept of each equation set
+    const bool telemetry =
+        problem.record_telemetry || bool(problem.telemetry_sink);
+};
+
+}  // namespace
+
+gcs::SweepResult gcs::Problem::sweep(
+    const std::vector<SweepParameter>& parameters,
+    const std::vector<double>& samples,
+    const std::vector<Variable*>& outputs,
+    size_t pool_size,
+    SchedulePolicy policy) {
+    assert(!parameters.empty() && samples.size() % parameters.size() == 0 &&
+           "There should be a value of every parameter for each sample");
+
+    const auto num_parameters = parameters.size();
+
+    SweepResult result{};
+    result.num_samples = samples.size() / num_parameters;
+    result.num_outputs = outputs.size();
+    result.values.resize(result.num_samples * result.num_outputs);
+    result.results.resize(result.num_samples);
+
+    TraceSpan span{tracer.get(), "sweep", "solve"};
+
+    std::vector<double> initial_parameters{};
+    for (auto& parameter : parameters) {
+        initial_parameters.push_back(*parameter.value);
+    }
+    auto order = nearest_neighbour_order(initial_parameters, samples);
+
+    values.gather();
+
+    if (!presolved.eliminations.empty()) {
+        // the presolve aliases depend on the parameters, and are shared by
+        // every sample, so the samples are solved one after another in the
+        // value store of this problem
+        std::vector<double> initial_values{};
+        values.save(initial_values);
+
+        for (auto i : order) {
+            for (size_t j = 0; j < num_parameters; ++j) {
+                *parameters[j].value = samples[i * num_parameters + j];
+                mark_dirty(parameters[j].constraint);
+            }
+
+            result.results[i] = solve_dirty(pool_size, policy);
+
+            for (size_t k = 0; k < outputs.size(); ++k) {
+                result.values[i * outputs.size() + k] = outputs[k]->value;
+            }
+        }
+
+        for (size_t j = 0; j < num_parameters; ++j) {
+            *parameters[j].value = initial_parameters[j];
+        }
+        values.load(initial_values);
+        values.scatter();
+        presolved.refresh();
+        return result;
+    }
+
+    // only the equation sets that read a parameter, and the ones downstream
+    // of them, are solved for each sample
+    std::unordered_set<EquationSet*> parameter_sets{};
+    for (auto& parameter : parameters) {
+        auto it = constraint_equations.find(parameter.constraint);
+        if (it == constraint_equations.end()) {
+            continue;
+        }
+        for (auto& eq : it->second) {
+            auto it2 = containing_set.find(eq);
+            if (it2 != containing_set.end()) {
+                parameter_sets.insert(it2->second);
+            }
+        }
+    }
+    auto targets = parameter_sets;
+    add_dependents(targets);
 
-    for (auto& eq_pair : solve_prereqs) {
-        auto& eq = eq_pair.first;
-        auto& pre = eq_pair.second;
+    SweepJob job{
+        *this, parameters, samples, outputs, parameter_sets, targets, result};
 
-        if (pre.size() == 0) {
-            not_solved.erase(eq);
-            boost::asio::post(pool, std::bind(solve_func, eq));
+    // split the nearest neighbour order into one chain per runner, so that
+    // each chain is a run of neighbouring samples
+    const size_t num_chains = std::min(
+        result.num_samples, pool_size == 0 ? executor->size() : pool_size);
+    {
+        Executor::TaskGroup group{*executor};
+        for (size_t c = 0; c < num_chains; ++c) {
+            const size_t* first =
+                order.data() + c * result.num_samples / num_chains;
+            const size_t* last =
+                order.data() + (c + 1) * result.num_samples / num_chains;
+            executor->post(group, [&job, first, last]() {
+                job.solve_chain(first, last);
+            });
         }
+        group.wait();
     }
 
-    pool.join();
+    for (size_t j = 0; j < num_parameters; ++j) {
+        *parameters[j].value = initial_parameters[j];
+    }
+
+    if (telemetry_sink) {
+        for (auto i : order) {
+            for (auto& record : result.results[i].records) {
+                telemetry_sink(record);
+            }
+        }
+    }
+    if (!record_telemetry) {
+        for (auto& sample_result : result.results) {
+            sample_result.records.clear();
+        }
+    }
+
+    return result;
+}
+
+gcs::ValueSnapshot gcs::Problem::snapshot() { return values.snapshot(); }
+
+void gcs::Problem::restore(const ValueSnapshot& snapshot) {
+    values.restore(snapshot);
+    presolved.write_back();
+}
+
+void gcs::Problem::lay_out_values() {
+    TraceSpan span{tracer.get(), "lay out values", "split"};
+
+    values.clear();
+    for (auto& eqn_set : equation_sets) {
+        for (auto& var : eqn_set->get_variables()) {
+            values.add(var);
+        }
+    }
+    for (auto& item : containing_set) {
+        for (auto& var : item.first->references) {
+            values.add(var);
+        }
+    }
+}
+
+void gcs::Problem::add_dependents(std::unordered_set<EquationSet*>& eqn_sets) {
+    std::vector<EquationSet*> stack{eqn_sets.begin(), eqn_sets.end()};
+    while (!stack.empty()) {
+        auto eqn_set = stack.back();
+        stack.pop_back();
+
+        auto it = is_prereq_of.find(eqn_set);
+        if (it == is_prereq_of.end()) {
+            continue;
+        }
+        for (auto& dep : it->second) {
+            if (eqn_sets.insert(dep).second) {
+                stack.push_back(dep);
+            }
+        }
+    }
+}
+
+void gcs::Problem::index_equation_set(EquationSet* eqn_set) {
+    for (auto& eq : eqn_set->equations) {
+        containing_set[eq] = eqn_set;
+
+        for (auto& var : eq->variables) {
+            solved_by[var] = eqn_set;
+        }
+    }
+}
+
+void gcs::Problem::link_equation_set(EquationSet* eqn_set) {
+    for (auto& eq : eqn_set->equations) {
+        for (auto& var : eq->references) {
+            // var is held constant by eq, so the equation set that solves for
+            // var has to be solved first
+            auto it = solved_by.find(var);
+            if (it == solved_by.end() || it->second == eqn_set) {
+                continue;
+            }
+
+            prereqs[eqn_set].insert(it->second);
+            is_prereq_of[it->second].insert(eqn_set);
+        }
+    }
+}
+
+namespace {
+
+using gcs::DependencyGraph;
+
+//! The state of solving a subset of the equation sets of one problem
+//!
+//! Equation sets are solved by up to pool_size runner tasks on the executor,
+//! which take ready equation sets until there are none left. Runners are added
+//! to a task group, so that the equation sets of many jobs (and problems) can
+//! be scheduled together and waited on once.
+class SolveJob {
+   public:
+    SolveJob(gcs::Problem& problem,
+             const std::unordered_set<gcs::EquationSet*>& targets,
+             size_t pool_size,
+             gcs::SchedulePolicy policy,
+             gcs::Executor& executor,
+             gcs::Executor::TaskGroup& group)
+        : problem{problem},
+          pool_size{pool_size == 0 ? executor.size() : pool_size},
+          executor{executor},
+          group{group},
+          // flat dependency graph of the targets (prereqs outside of the
+          // targets are already solved)
+          graph{targets, problem.is_prereq_of},
+          // track equation set dependencies as they get solved
+          remaining_prereqs{graph},
+          contexts(graph.size()) {
+        // ready equation sets, in the order of the scheduling policy
+        if (policy == gcs::SchedulePolicy::critical_path) {
+            priorities =
+                graph.critical_path_costs(gcs::estimate_solve_costs(graph));
+            ready.reset(new gcs::ReadyQueue{priorities});
+        } else {
+            ready.reset(new gcs::ReadyQueue{graph.size()});
+        }
+
+        // look up (or make room for) the compiled ceres problem of each
+        // equation set up front, so the map isn't modified from the worker
+        // threads
+        for (DependencyGraph::Id id = 0; id < graph.size(); ++id) {
+            contexts[id] = &problem.solver_contexts[graph.equation_sets[id]];
+        }
+
+        // variables eliminated by presolve are read through their aliases
+        if (!problem.presolved.eliminations.empty()) {
+            aliases = &problem.presolved;
+        }
 
-    for (auto& eq_pair : solve_prereqs) {
-        assert(eq_pair.second.size() == 0 &&
+        // each runner writes the records of the equation sets it solves
+        if (telemetry) {
+            records.resize(graph.size());
+            ready_times.resize(graph.size());
+        }
+    }
+
+    SolveJob(const SolveJob&) = delete;
+    SolveJob& operator=(const SolveJob&) = delete;
+
+    //! @returns the number of equation sets to solve
+    DependencyGraph::Id size() const { return graph.size(); }
+
+    //! Queues the equation sets without prerequisites and starts the runners
+    void start() {
+        // the store still holds the values from the end of the last solve,
+        // which are kept in case the solve has to be rolled back
+        if (problem.rollback_on_failure) {
+            before = problem.values.snapshot();
+        }
+
+        // equation sets are solved in the value store, which starts out with
+        // the current values of the variables
+        problem.values.gather();
+
+        start_time = std::chrono::steady_clock::now();
+        end_time.store(start_time.time_since_epoch().count());
+        std::fill(ready_times.begin(),
+                  ready_times.end(),
+                  start_time.time_since_epoch().count());
+
+        // all roots are queued before any runner starts, as a runner that
+        // finds the queue empty stops (later pushes only come from running
+        // runners, which always take from the queue again before they stop)
+        size_t num_roots = 0;
+        for (DependencyGraph::Id id = 0; id < graph.size(); ++id) {
+            if (graph.num_prereqs[id] == 0) {
+                ready->push(id);
+                ++num_roots;
+            }
+        }
+        for (size_t i = 0; i < num_roots; ++i) {
+            spawn();
+        }
+    }
+
+    //! Writes back the values of the variables (or rolls them back if an
+    //! equation set failed), once the task group of the job is done
+    //!
+    //! @returns the summary of the solve
+    gcs::SolveResult finish() {
+        assert(remaining_prereqs.all_released() &&
                "There should be no equation sets waiting on prereqs");
+
+        gcs::SolveResult result{};
+
+        // the solved values were written through pointers into the store
+        auto& values = problem.values;
+        for (auto eqn_set : graph.equation_sets) {
+            for (auto& eq : eqn_set->equations) {
+                for (auto& var : eq->variables) {
+                    if (values.contains(var)) {
+                        values.mark_changed(var->slot);
+                    }
+                }
+            }
+        }
+
+        if (num_failed.load() > 0 && problem.rollback_on_failure) {
+            values.restore(before);
+            result.rolled_back = true;
+        } else {
+            values.scatter();
+        }
+
+        // the variables eliminated by presolve are written back from the
+        // variables they're aliased to
+        problem.presolved.write_back();
+
+        result.num_equation_sets = graph.size();
+        result.num_direct = num_direct.load();
+        result.num_failed = num_failed.load();
+        result.wall_time = std::chrono::duration<double>(
+                               Clock::duration{end_time.load()} -
+                               start_time.time_since_epoch())
+                               .count();
+
+        if (problem.tracer) {
+            trace(*problem.tracer);
+        }
+
+        if (telemetry) {
+            std::stable_sort(
+                records.begin(),
+                records.end(),
+                [](const gcs::SolveRecord& a, const gcs::SolveRecord& b) {
+                    return a.start_time < b.start_time;
+                });
+            if (problem.telemetry_sink) {
+                for (auto& record : records) {
+                    problem.telemetry_sink(record);
+                }
+            }
+            if (problem.record_telemetry) {
+                result.records = std::move(records);
+            }
+        }
+
+        return result;
+    }
+
+   private:
+    using Clock = std::chrono::steady_clock;
+
+    //! Adds a span of each equation set on the thread that solved it, with an
+    //! arrow to each equation set that depends on it
+    void trace(gcs::Tracer& tracer) const {
+        auto time = [this](double seconds) {
+            return start_time + std::chrono::duration_cast<Clock::duration>(
+                                    std::chrono::duration<double>(seconds));
+        };
+
+        for (DependencyGraph::Id id = 0; id < graph.size(); ++id) {
+            auto& record = records[id];
+            auto start = time(record.start_time);
+            auto end = time(record.start_time + record.solve_time);
+
+            std::ostringstream args{};
+            args << "\"equations\": " << record.num_equations
+                 << ", \"direct\": " << (record.direct ? "true" : "false")
+                 << ", \"queue_wait_us\": " << record.queue_wait * 1e6
+                 << ", \"iterations\": " << record.iterations
+                 << ", \"final_cost\": " << record.final_cost;
+            tracer.add_span("equation set " + std::to_string(id),
+                            "solve",
+                            start,
+                            end,
+                            record.thread,
+                            args.str());
+
+            // arrows start just before the end of the prerequisite
+            auto from = std::max(start, end - std::chrono::microseconds{1});
+            for (auto i = graph.successor_offsets[id];
+                 i < graph.successor_offsets[id + 1];
+                 ++i) {
+                auto& next = records[graph.successors[i]];
+                tracer.add_flow(
+                    from, record.thread, time(next.start_time), next.thread);
+            }
+        }
+    }
+
+    //! Starts another runner, unless there are already pool_size of them
+    void spawn() {
+        auto n = runners.load();
+        while (n < pool_size) {
+            if (runners.compare_exchange_weak(n, n + 1)) {
+                executor.post(group, [this]() { run(); });
+                return;
+            }
+        }
+    }
+
+    //! Records when an equation set became ready to solve
+    void mark_ready(DependencyGraph::Id id) {
+        if (telemetry) {
+            ready_times[id] = Clock::now().time_since_epoch().count();
+        }
+    }
+
+    //! Solves a single equation set
+    void solve(DependencyGraph::Id id) {
+        auto& eqn_set = *graph.equation_sets[id];
+        auto start = Clock::now();
+        gcs::SolveRecord record{};
+
+        if (!solve_equation_set(problem,
+                                eqn_set,
+                                aliases,
+                                problem.values,
+                                *contexts[id],
+                                record)) {
+            ++num_failed;
+        }
+        if (record.direct) {
+            ++num_direct;
+        }
+
+        auto end = Clock::now();
+        eqn_set.solve_time = std::chrono::duration<double>(end - start).count();
+
+        if (telemetry) {
+            record.eqn_set = &eqn_set;
+            record.num_equations = eqn_set.equations.size();
+            record.start_time =
+                std::chrono::duration<double>(start - start_time).count();
+            record.queue_wait =
+                std::chrono::duration<double>(
+                    start.time_since_epoch() - Clock::duration{ready_times[id]})
+                    .count();
+            record.solve_time = eqn_set.solve_time;
+            record.thread = std::this_thread::get_id();
+            records[id] = record;
+        }
+    }
+
+    //! Main loop of a runner
+    //!
+    //! It solves an equation set, then updates the active equation set
+    //! dependencies. If this update makes it so other equation sets don't
+    //! depend on anything else, the one that comes first in the scheduling
+    //! order is solved next by the same runner, and the rest are queued for
+    //! any runner. Fused chains are solved back to back without updating any
+    //! dependencies.
+    void run() {
+        DependencyGraph::Id id;
+        bool have_next = ready->pop(id);
+
+        while (have_next) {
+            solve(id);
+
+            if (graph.chain_next[id] != DependencyGraph::none) {
+                id = graph.chain_next[id];
+                mark_ready(id);
+                continue;
+            }
+
+            // once the equation set has been solved:
+            DependencyGraph::Id next = 0;
+            size_t num_ready = 0;
+            for (auto i = graph.successor_offsets[id];
+                 i < graph.successor_offsets[id + 1];
+                 ++i) {
+                auto req_by = graph.successors[i];
+
+                // the just-solved equation is no longer holding up its
+                // dependencies, so if the dependency isn't waiting on
+                // anything else, it is ready to solve
+                if (!remaining_prereqs.release(req_by)) {
+                    continue;
+                }
+                mark_ready(req_by);
+
+                if (num_ready++ == 0) {
+                    next = req_by;
+                    continue;
+                }
+                if (!priorities.empty() &&
+                    priorities[req_by] > priorities[next]) {
+                    std::swap(next, req_by);
+                }
+                ready->push(req_by);
+                spawn();
+            }
+
+            // otherwise take an equation set that was queued by any runner
+            have_next = num_ready > 0;
+            if (have_next) {
+                id = next;
+            } else {
+                have_next = ready->pop(id);
+            }
+        }
+
+        // the job ends when its last runner stops
+        auto now = Clock::now().time_since_epoch().count();
+        auto end = end_time.load();
+        while (end < now && !end_time.compare_exchange_weak(end, now)) {
+        }
+        runners.fetch_sub(1);
+    }
+
+    gcs::Problem& problem;
+    const size_t pool_size;
+    gcs::Executor& executor;
+    gcs::Executor::TaskGroup& group;
+
+    const DependencyGraph graph;
+    gcs::DependencyCounters remaining_prereqs;
+    std::vector<double> priorities{};
+    gcs::uptr<gcs::ReadyQueue> ready{};
+    std::vector<gcs::uptr<gcs::SolverContext>*> contexts;
+    const gcs::Presolve* aliases = nullptr;
+    //! The values from before the solve, if it may be rolled back
+    gcs::ValueSnapshot before{};
+
+    //! True if records are kept of each equation set
+    const bool telemetry = problem.record_telemetry ||
+                           bool(problem.telemetry_sink) || bool(problem.tracer);
+    //! The record of each equation set, indexed by id
+    std::vector<gcs::SolveRecord> records{};
+    //! When each equation set became ready to solve, indexed by id
+    std::vector<Clock::rep> ready_times{};
+
+    std::atomic<size_t> runners{0};
+    std::atomic<size_t> num_direct{0};
+    std::atomic<size_t> num_failed{0};
+    Clock::time_point start_time{};
+    std::atomic<Clock::rep> end_time{0};
+};
+
+}  // namespace
+
+gcs::SolveResult gcs::Problem::solve(size_t pool_size, SchedulePolicy policy) {
+    dirty_sets.clear();
+    return solve(equation_sets, pool_size, policy);
+}
+
+gcs::SolveResult gcs::Problem::solve(
+    const std::unordered_set<EquationSet*>& targets,
+    size_t pool_size,
+    SchedulePolicy policy) {
+    if (targets.empty()) {
+        return {};
+    }
+
+    TraceSpan span{tracer.get(), "solve", "solve"};
+
+    // builds the dependency graph and ready queue of the targets
+    TraceSpan schedule_span{tracer.get(), "schedule", "solve"};
+    Executor::TaskGroup group{*executor};
+    SolveJob job{*this, targets, pool_size, policy, *executor, group};
+    schedule_span.end();
+
+    TraceSpan run_span{tracer.get(), "solve equation sets", "solve"};
+    job.start();
+    group.wait();
+    run_span.end();
+
+    TraceSpan finish_span{tracer.get(), "write back", "solve"};
+    return job.finish();
+}
+
+std::vector<gcs::SolveResult> gcs::solve_batch(
+    const std::vector<Problem*>& problems,
+    SchedulePolicy policy,
+    Executor& executor) {
+    Executor::TaskGroup group{executor};
+
+    std::vector<uptr<SolveJob>> jobs{};
+    jobs.reserve(problems.size());
+    for (auto problem : problems) {
+        problem->dirty_sets.clear();
+        jobs.emplace_back(new SolveJob{
+            *problem, problem->equation_sets, 0, policy, executor, group});
+    }
+
+    // start the largest problems first, so they don't end up being solved
+    // last while the other cores are idle
+    std::vector<SolveJob*> order{};
+    for (auto& job : jobs) {
+        order.push_back(job.get());
+    }
+    std::stable_sort(order.begin(), order.end(), [](SolveJob* a, SolveJob* b) {
+        return a->size() > b->size();
+    });
+    for (auto job : order) {
+        job->start();
+    }
+
+    group.wait();
+
+    std::vector<SolveResult> results{};
+    results.reserve(jobs.size());
+    for (auto& job : jobs) {
+        results.push_back(job->finish());
     }
+    return results;
 }
@@ -3,23 +3,113 @@
 
 #include <ceres/ceres.h>
 
-#include <boost/asio.hpp>
+#include <memory>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+#include "gcs/core/arena.h"
 #include "gcs/core/constraints.h"
+#include "gcs/core/dependency_graph.h"
+#include "gcs/core/executor.h"
 #include "gcs/core/geometry.h"
+#include "gcs/core/presolve.h"
 #include "gcs/core/solve_elements.h"
+#include "gcs/core/split_equation_sets.h"
+#include "gcs/core/telemetry.h"
+#include "gcs/core/value_store.h"
 
 namespace gcs {
 
+//! A ceres problem compiled for a single equation set
+//!
+//! The residual blocks of the equation set are added and the parameter blocks
+//! that aren't solved by the equation set are held constant once, when the
+//! context is made. The parameter blocks point directly at the variable
+//! values (or at their slots in a value store), so the context can be solved
+//! again after any value changes, as long as the structure of the equation set
+//! and the slots stay the same.
+struct SolverContext {
+    //! The ceres problem, which owns the cost functions
+    ceres::Problem problem;
+    //! The options used to solve the problem
+    ceres::Solver::Options options;
+
+    //! Builds the ceres problem for an equation set
+    //!
+    //! @param eqn_set the equation set, which must already be split
+    //! @param presolved aliases of the variables eliminated by presolve, if any
+    //! @param values the value store to solve in, if any
+    //! @param fuse if true, and the values solved for fill a range of slots in
+    //! the value store, all residual blocks are evaluated as one
+    //! FusedCostFunction with one parameter block
+    explicit SolverContext(EquationSet& eqn_set,
+                           const Presolve* presolved = nullptr,
+                           ValueStore* values = nullptr,
+                           bool fuse = false);
+};
+
 //! Run ceres to solve a single equation set
 //!
 //! @param eqn_set the equation set to solve
 //! @returns the ceres solver summary
 ceres::Solver::Summary single_solve(EquationSet& eqn_set);
 
+//! Run ceres to solve a compiled equation set
+//!
+//! @param context the compiled equation set to solve
+//! @returns the ceres solver summary
+ceres::Solver::Summary single_solve(SolverContext& context);
+
+//! Summary of solving the equation sets of a problem
+struct SolveResult {
+    //! Number of equation sets that were solved
+    size_t num_equation_sets = 0;
+    //! Number of equation sets that were solved in closed form
+    size_t num_direct = 0;
+    //! Number of equation sets where ceres didn't converge
+    size_t num_failed = 0;
+    //! True if the values of the variables were rolled back because an
+    //! equation set failed
+    //! @see Problem::rollback_on_failure
+    bool rolled_back = false;
+    //! Time from the start of the solve until the last equation set was
+    //! solved, in seconds
+    double wall_time = 0.0;
+    //! What happened to each equation set, in the order they started solving
+    //! (only kept if Problem::record_telemetry is set)
+    std::vector<SolveRecord> records;
+
+    //! @returns true if every equation set converged
+    bool success() const { return num_failed == 0; }
+};
+
+//! A value that is set for each sample of a sweep, such as the value of a
+//! SetConstant
+struct SweepParameter {
+    //! The constraint that the value belongs to
+    Constraint* constraint;
+    //! The value to set
+    double* value;
+};
+
+//! Results of solving a problem for many samples of its parameters
+//! @see Problem::sweep
+struct SweepResult {
+    size_t num_samples = 0;
+    size_t num_outputs = 0;
+    //! Value of each output variable for each sample, stored by sample (the
+    //! outputs of sample i start at values[i * num_outputs])
+    std::vector<double> values;
+    //! Summary of solving each sample
+    std::vector<SolveResult> results;
+
+    //! @returns the value of an output variable for a sample
+    double at(size_t sample, size_t output) const {
+        return values[sample * num_outputs + output];
+    }
+};
+
 //! Definition of a geometric constraint solving problem
 struct Problem {
     //! All variables that aren't used to define a geometry component
@@ -31,13 +121,123 @@ struct Problem {
 
     // For internal use: (TODO: make proteceted?)
 
-    //! Set of all EquationSets (this class has ownership of pointers)
+    //! Owns the equations of all constraints and all equation sets
+    //!
+    //! Everything in the arena is destroyed at once when this problem is
+    //! reset, and incremental edits return the slots of removed equations and
+    //! equation sets to the arena for reuse, so memory doesn't grow over a
+    //! long editing session.
+    Arena arena;
+
+    //! Set of all EquationSets (which are owned by the arena)
     std::unordered_set<EquationSet*> equation_sets;
     // All items in the set must be solved before the key can be solved
     std::unordered_map<EquationSet*, std::unordered_set<EquationSet*>> prereqs;
     // The key must be solved before any of the values in the set can be solved
     std::unordered_map<EquationSet*, std::unordered_set<EquationSet*>>
         is_prereq_of;
+    //! The equations that were made for each constraint
+    std::unordered_map<Constraint*, std::vector<Equation*>>
+        constraint_equations;
+    //! The equation set that contains each equation
+    std::unordered_map<Equation*, EquationSet*> containing_set;
+    //! The equation set that solves for each variable
+    std::unordered_map<Variable*, EquationSet*> solved_by;
+    //! The values of all variables used by the equation sets, which are
+    //! solved in place
+    //!
+    //! Slots are assigned one equation set at a time when the problem is
+    //! split, and new variables are appended by incremental edits.
+    //! @see lay_out_values
+    ValueStore values;
+    //! Compiled ceres problem of each equation set that has been solved,
+    //! which is reused until the equation set is replaced (or the value store
+    //! is moved)
+    std::unordered_map<EquationSet*, uptr<SolverContext>> solver_contexts;
+    //! Equation sets whose inputs changed since they were last solved
+    //! @see mark_dirty
+    std::unordered_set<EquationSet*> dirty_sets;
+
+    //! The worker threads that equation sets are solved on, which can be
+    //! shared with other problems (by default, all problems use
+    //! Executor::shared())
+    std::shared_ptr<Executor> executor = Executor::shared();
+
+    //! If true, the values of all variables are restored to the end of the
+    //! last solve when any equation set of a solve fails to converge, so a
+    //! failed solve never leaves the problem partly updated
+    //!
+    //! This includes values that were changed since the last solve (such as
+    //! a point being dragged), but not the parameters of constraints.
+    bool rollback_on_failure = true;
+
+    //! If true, a SolveRecord of each equation set that is solved is returned
+    //! in SolveResult::records
+    bool record_telemetry = false;
+    //! If set, receives a SolveRecord of each equation set after each solve
+    //! (whether or not record_telemetry is set)
+    TelemetrySink telemetry_sink;
+    //! If true, ceres prints the progress of each equation set it solves to
+    //! stdout (which slows down solving, as it happens on every thread)
+    bool log_solver_progress = false;
+    //! If set, a span of each phase of editing, splitting and solving (and of
+    //! each equation set that is solved) is added to this tracer
+    std::shared_ptr<Tracer> tracer;
+
+    //! If true, equation sets that match one of the closed form rules are
+    //! solved directly instead of with ceres
+    //! @see direct_solve
+    bool use_direct_solve = true;
+
+    //! If true, ceres solves each equation set as a single residual block over
+    //! a single parameter block, which saves its per block overhead
+    //!
+    //! Equations that have a batch kernel, such as the generated point on line
+    //! and distance equations, are then also evaluated in batches.
+    //!
+    //! Only takes effect for equation sets whose ceres problem is built after
+    //! it changes.
+    //! @see FusedCostFunction
+    bool fuse_residuals = true;
+
+    //! If true, equate and difference equations are eliminated by aliasing
+    //! variables before splitting, and the values of the eliminated variables
+    //! are written back after solving
+    //!
+    //! The aliases can't be patched in place, so constraint edits re-split the
+    //! whole problem while this is enabled.
+    //! @see presolve
+    bool use_presolve = false;
+    //! Equations and variables eliminated by the last presolve
+    Presolve presolved;
+
+    //! If true, adding or removing a constraint only re-splits and re-solves
+    //! the equation sets affected by the change. Otherwise the whole problem
+    //! is reset, split and solved again.
+    bool incremental = true;
+
+    //! Number of nested edits that are in progress
+    //! @see begin_edit
+    size_t edit_depth = 0;
+    //! Constraints added since the last structural update
+    std::unordered_set<Constraint*> pending_added;
+    //! Constraints removed since the last structural update
+    std::unordered_set<Constraint*> pending_removed;
+
+    //! Groups many changes to this problem into a single edit
+    //!
+    //! The edit begins on construction and is committed on destruction.
+    //!
+    //! @see begin_edit
+    struct EditScope {
+        Problem& problem;
+
+        explicit EditScope(Problem& problem);
+        ~EditScope();
+
+        EditScope(const EditScope&) = delete;
+        EditScope& operator=(const EditScope&) = delete;
+    };
 
     //! Add a component to this problem
     //! @see add_variable
@@ -57,7 +257,10 @@ struct Problem {
     //! Add a constraint to this problem
     //!
     //! Causes an update to the structure of the problem and triggers equation
-    //! set splitting and re-solving
+    //! set splitting and re-solving, unless an edit is in progress
+    //!
+    //! @see incremental
+    //! @see begin_edit
     bool add_constraint(Constraint* constraint);
 
     //! Remove a component from this problem
@@ -78,15 +281,44 @@ struct Problem {
     //! Remove a constraint from this problem
     //!
     //! Causes an update to the structure of the problem and triggers equation
-    //! set splitting and re-solving
+    //! set splitting and re-solving, unless an edit is in progress
+    //!
+    //! @see incremental
+    //! @see begin_edit
     bool remove_constraint(Constraint* constraint);
 
     ~Problem();
 
+    //! Begins an edit of this problem
+    //!
+    //! Until the matching call to commit_edit, adding and removing constraints
+    //! only records the change. Edits can be nested, in which case only the
+    //! outermost commit updates the problem.
+    //!
+    //! @see EditScope
+    void begin_edit();
+
+    //! Commits an edit of this problem
+    //!
+    //! If this ends the outermost edit, all recorded changes are applied with
+    //! a single split and solve.
+    //!
+    //! @param pool_size The maximum number of equation sets to solve at once
+    //! @see solve(size_t, SchedulePolicy)
+    void commit_edit(size_t pool_size = 0);
+
+    //! Applies all recorded constraint changes, then splits and solves the
+    //! affected parts of the problem
+    void apply_edits(size_t pool_size = 0);
+
     //! Reinitializes this problem to use a single equation set
     //!
     //! Uses the Equations defined by all contraints and places them into a
-    //! single EquationSet
+    //! single EquationSet. Any pending edits are included. If use_presolve is
+    //! set, the equations eliminated by presolve are left out.
+    //!
+    //! All equations and equation sets of the previous structure are
+    //! destroyed.
     void reset_to_single_equation_set();
 
     //! Splits the equation sets for this problem into smaller constrained sets
@@ -104,7 +336,30 @@ struct Problem {
     //! equation sets. Any subsequent equation set that is found which depends
     //! on one of these variables now becomes dependent on the original equation
     //! set.
-    void split();
+    //!
+    //! @param method The algorithm used to split each equation set. Block
+    //! triangular decomposition is used by default, the frontier search is
+    //! kept available for comparison.
+    void split(SplitMethod method = SplitMethod::block_triangular);
+
+    //! Re-splits only the part of the problem affected by a structural change
+    //!
+    //! The equation sets that solve for a variable used by an added equation,
+    //! or that contain a removed equation, are gathered together with every
+    //! equation set that depends on them. Only those equations are
+    //! decomposed again; all other equation sets are kept, and the variables
+    //! they solve for are held constant. Dependencies are patched in place.
+    //!
+    //! Removed equations are destroyed by this function. Conflicting
+    //! (over-constrained) equations are kept local to the affected equation
+    //! sets, so they may be grouped differently than by a full split().
+    //!
+    //! @param added equations that were added to the problem
+    //! @param removed equations that were removed from the problem
+    //! @returns the new equation sets, which need to be solved again
+    std::unordered_set<EquationSet*> resplit(
+        const std::vector<Equation*>& added,
+        const std::vector<Equation*>& removed);
 
     //! Solves this problem
     //!
@@ -112,13 +367,156 @@ struct Problem {
     //! will wait until the dependencies are solved and computed before starting
     //! to solve the dependent equation set.
     //!
-    //! @param pool_size The size to use for the thread pool. If not given,
-    //! defaults to the hardware concurrency value. Multiple equation sets will
-    //! only be solved concurrently if allowed by the structure of the equation
-    //! set dependency graph.
-    void solve(size_t pool_size = 0);
+    //! Equation sets are solved on the executor of this problem, and the
+    //! calling thread helps out until they're done.
+    //!
+    //! @param pool_size The maximum number of equation sets of this problem to
+    //! solve at the same time. If not given, defaults to the number of
+    //! executor threads. Multiple equation sets will only be solved
+    //! concurrently if allowed by the structure of the equation set dependency
+    //! graph.
+    //! @param policy The order in which ready equation sets are solved
+    //! @returns the summary of the solve
+    SolveResult solve(size_t pool_size = 0,
+                      SchedulePolicy policy = SchedulePolicy::critical_path);
+
+    //! Solves a subset of the equation sets of this problem
+    //!
+    //! Prerequisites that aren't part of the subset are assumed to already be
+    //! solved.
+    //!
+    //! @param targets The equation sets to solve
+    //! @param pool_size The maximum number of equation sets to solve at once
+    //! @param policy The order in which ready equation sets are solved
+    //! @see solve(size_t, SchedulePolicy)
+    //! @returns the summary of the solve
+    SolveResult solve(const std::unordered_set<EquationSet*>& targets,
+                      size_t pool_size = 0,
+                      SchedulePolicy policy = SchedulePolicy::critical_path);
+
+    //! Marks a variable whose value was changed
+    //!
+    //! The equation set that solves for the variable and the equation sets
+    //! that hold it constant are solved again by the next call to
+    //! solve_dirty. The structure of the problem isn't changed.
+    //!
+    //! @returns false if the variable isn't used by any equation set
+    bool mark_dirty(Variable* var);
+    //! Marks a constraint whose parameters were changed (for example the value
+    //! of a SetConstant)
+    //!
+    //! The equation sets that contain the equations of the constraint are
+    //! solved again by the next call to solve_dirty.
+    //!
+    //! @returns false if the constraint isn't part of the split problem
+    bool mark_dirty(Constraint* constraint);
+
+    //! Solves the equation sets that were marked dirty, along with every
+    //! equation set that depends on them
+    //!
+    //! All other equation sets keep their current solution.
+    //!
+    //! @param pool_size The maximum number of equation sets to solve at once
+    //! @param policy The order in which ready equation sets are solved
+    //! @see mark_dirty
+    //! @see solve(size_t, SchedulePolicy)
+    //! @returns the summary of the solve
+    SolveResult solve_dirty(
+        size_t pool_size = 0,
+        SchedulePolicy policy = SchedulePolicy::critical_path);
+
+    //! Solves this problem for many samples of some of its parameters
+    //!
+    //! The problem is split once (it must already be split) and only the
+    //! equation sets that depend on the parameters are solved again for each
+    //! sample. Each sample is warm started from the solution of a neighbouring
+    //! sample: samples are solved in a nearest neighbour order (with each
+    //! parameter scaled by its range), starting from the sample closest to the
+    //! current parameter values, which also keeps the solutions of the
+    //! samples on the same branch.
+    //!
+    //! The order is split into one chain of neighbouring samples per runner,
+    //! and the chains are solved in parallel on the executor. Each chain
+    //! starts from the current solution and solves in its own copy of the
+    //! value store. The equation sets that read a parameter are solved by one
+    //! chain at a time, as the parameters are shared. If presolve eliminated
+    //! any equations, the samples are solved one after another instead, since
+    //! the aliases depend on the parameters.
+    //!
+    //! The parameters and the values of all variables are restored afterwards.
+    //!
+    //! @param parameters the values that are set for each sample
+    //! @param samples the parameter values of each sample, stored by sample
+    //! (the parameters of sample i start at samples[i * parameters.size()])
+    //! @param outputs the variables whose values are recorded for each sample
+    //! @param pool_size The maximum number of samples to solve at once (or
+    //! of equation sets, if the samples are solved one after another)
+    //! @param policy The order in which ready equation sets are solved, if the
+    //! samples are solved one after another
+    //! @returns the values of the outputs for each sample, in the order of the
+    //! samples
+    SweepResult sweep(const std::vector<SweepParameter>& parameters,
+                      const std::vector<double>& samples,
+                      const std::vector<Variable*>& outputs,
+                      size_t pool_size = 0,
+                      SchedulePolicy policy = SchedulePolicy::critical_path);
+
+    //! Assigns a slot in the value store to every variable used by the
+    //! equation sets
+    //!
+    //! The variables that each equation set solves for are given consecutive
+    //! slots, then the variables that are only held constant are added.
+    void lay_out_values();
+
+    //! Takes a snapshot of the values of all variables, as of the end of the
+    //! last solve
+    //!
+    //! Values that were changed since the last solve aren't included until
+    //! they're solved. Taking a snapshot is O(1) if no value was solved since
+    //! the last snapshot, and otherwise only copies the pages of values that
+    //! changed (see ValueSnapshot), so a snapshot can be taken for every step
+    //! of an undo stack.
+    ValueSnapshot snapshot();
+
+    //! Sets the variables back to their values in a snapshot
+    //!
+    //! The problem doesn't need to be solved again. Variables eliminated by
+    //! presolve are set from their aliases.
+    //!
+    //! @param snapshot a snapshot of this problem, which may be from before
+    //! a structural change as long as all of its variables still exist
+    void restore(const ValueSnapshot& snapshot);
+
+    //! Adds every equation set that depends on the given equation sets,
+    //! directly or indirectly
+    void add_dependents(std::unordered_set<EquationSet*>& eqn_sets);
+
+    //! Records which equation set contains each equation of an equation set,
+    //! and which equation set solves each of its variables
+    void index_equation_set(EquationSet* eqn_set);
+
+    //! Adds the dependencies of an equation set on the equation sets that
+    //! solve for the variables it holds constant
+    void link_equation_set(EquationSet* eqn_set);
 };
 
+//! Solves many problems together on one executor
+//!
+//! The equation sets of all problems are scheduled at once, so the cores are
+//! balanced across problems: small problems fill in around large ones, and a
+//! large problem can use every core. Larger problems are started first. Each
+//! problem must already be split, and all of its equation sets are solved.
+//!
+//! @param problems the problems to solve, which must all be different
+//! @param policy the order in which ready equation sets of each problem are
+//! solved
+//! @param executor the executor to solve on (instead of Problem::executor)
+//! @returns the summary of solving each problem, in the order of problems
+std::vector<SolveResult> solve_batch(
+    const std::vector<Problem*>& problems,
+    SchedulePolicy policy = SchedulePolicy::critical_path,
+    Executor& executor = *Executor::shared());
+
 }  // namespace gcs
 
 #endif  // GCS_CORE_PROBLEM
@@ -0,0 +1,534 @@
+#include "gcs/core/problem_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <unordered_set>
+
+#include "gcs/core/dependency_graph.h"
+
+namespace gcs {
+
+namespace {
+
+//! Builds the contents of a problem file
+class FileWriter {
+   public:
+    FileWriter() : buffer(sizeof(file::Header), 0) {}
+
+    //! Appends a section, aligned to 8 bytes
+    template <typename T>
+    file::Section append(const std::vector<T>& records) {
+        buffer.resize((buffer.size() + 7) / 8 * 8, 0);
+
+        file::Section section{buffer.size(), records.size()};
+        buffer.resize(buffer.size() + records.size() * sizeof(T));
+        if (!records.empty()) {
+            std::memcpy(&buffer[section.offset],
+                        records.data(),
+                        records.size() * sizeof(T));
+        }
+        return section;
+    }
+
+    file::Header& header() {
+        return *reinterpret_cast<file::Header*>(buffer.data());
+    }
+
+    bool write(const std::string& path) const {
+        std::ofstream out{path, std::ios::binary | std::ios::trunc};
+        out.write(buffer.data(), buffer.size());
+        return static_cast<bool>(out);
+    }
+
+   private:
+    std::vector<char> buffer;
+};
+
+//! Type names, each stored once
+class StringTable {
+   public:
+    uint32_t add(const std::string& str) {
+        auto it = offsets.find(str);
+        if (it != offsets.end()) {
+            return it->second;
+        }
+
+        uint32_t offset = chars.size();
+        chars.insert(chars.end(), str.begin(), str.end());
+        chars.push_back('\0');
+        offsets.emplace(str, offset);
+        return offset;
+    }
+
+    const std::vector<char>& data() const { return chars; }
+
+   private:
+    std::vector<char> chars;
+    std::unordered_map<std::string, uint32_t> offsets;
+};
+
+//! @returns true if the records of a section lie within a file of the given
+//! size
+template <typename T>
+bool fits(const file::Section& section, size_t size) {
+    return section.offset % alignof(T) == 0 && section.offset <= size &&
+           section.count <= (size - section.offset) / sizeof(T);
+}
+
+//! @returns true if a range of records lies within a section
+bool in_range(uint64_t first, uint64_t count, const file::Section& section) {
+    return first <= section.count && count <= section.count - first;
+}
+
+}  // namespace
+
+bool save_problem(Problem& problem, const std::string& path) {
+    if (!problem.pending_added.empty() || !problem.pending_removed.empty()) {
+        return false;
+    }
+
+    StringTable strings{};
+    std::vector<Constraint*> constraints{problem.constraints.begin(),
+                                         problem.constraints.end()};
+
+    // gather the geometry, including the geometry that is only referred to
+    // by constraints
+    std::vector<Geometry*> geoms{problem.geoms.begin(), problem.geoms.end()};
+    std::unordered_set<Geometry*> seen{geoms.begin(), geoms.end()};
+    for (auto& constraint : constraints) {
+        for (auto& arg : constraint->get_arguments()) {
+            if (arg.geometry && seen.insert(arg.geometry).second) {
+                geoms.push_back(arg.geometry);
+            }
+        }
+    }
+
+    // larger geometry comes first, so a sub-component is always found in the
+    // geometry that contains it
+    std::vector<std::vector<Variable*>> geom_variables{};
+    for (auto& geom : geoms) {
+        geom_variables.push_back(geom->get_variables());
+    }
+    std::vector<size_t> order(geoms.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return geom_variables[a].size() > geom_variables[b].size();
+    });
+
+    std::unordered_map<Variable*, uint32_t> variable_index{};
+    std::vector<double> values{};
+    auto add_variable = [&](Variable* var) {
+        if (variable_index.emplace(var, values.size()).second) {
+            values.push_back(var->value);
+        }
+    };
+
+    std::vector<file::GeometryRecord> geometry_records{};
+    for (auto i : order) {
+        const auto& vars = geom_variables[i];
+        if (*geoms[i]->type_name() == '\0') {
+            return false;
+        }
+        if (vars.empty() ||
+            variable_index.find(vars[0]) != variable_index.end()) {
+            continue;
+        }
+
+        geometry_records.push_back({strings.add(geoms[i]->type_name()),
+                                    static_cast<uint32_t>(values.size()),
+                                    static_cast<uint32_t>(vars.size()),
+                                    0});
+        for (auto& var : vars) {
+            add_variable(var);
+        }
+    }
+
+    // everything else is a standalone variable
+    for (auto& var : problem.variables) {
+        add_variable(var);
+    }
+
+    std::vector<file::ConstraintRecord> constraint_records{};
+    std::vector<file::ArgumentRecord> arguments{};
+    std::vector<double> parameters{};
+
+    for (auto& constraint : constraints) {
+        if (*constraint->type_name() == '\0') {
+            return false;
+        }
+
+        file::ConstraintRecord record{};
+        record.type = strings.add(constraint->type_name());
+        record.first_argument = arguments.size();
+        record.first_parameter = parameters.size();
+
+        for (auto& arg : constraint->get_arguments()) {
+            if (arg.geometry) {
+                auto vars = arg.geometry->get_variables();
+                if (vars.empty()) {
+                    return false;
+                }
+                arguments.push_back({strings.add(arg.geometry->type_name()),
+                                     variable_index.at(vars[0])});
+            } else {
+                add_variable(arg.variable);
+                arguments.push_back(
+                    {file::none, variable_index.at(arg.variable)});
+            }
+        }
+        for (auto& param : constraint->get_parameters()) {
+            parameters.push_back(param);
+        }
+
+        record.num_arguments = arguments.size() - record.first_argument;
+        record.num_parameters = parameters.size() - record.first_parameter;
+        constraint_records.push_back(record);
+    }
+
+    // the equation sets can only be stored if every equation belongs to one,
+    // which isn't the case after presolve
+    const bool has_split =
+        !problem.equation_sets.empty() &&
+        problem.presolved.eliminations.empty() &&
+        problem.constraint_equations.size() == constraints.size();
+
+    std::vector<file::EquationRecord> equations{};
+    std::vector<uint32_t> equation_variables{};
+    std::vector<file::EquationSetRecord> equation_sets{};
+    std::vector<uint32_t> set_equations{};
+    std::vector<uint32_t> successor_offsets{};
+    std::vector<uint32_t> successors{};
+
+    if (has_split) {
+        std::unordered_map<Equation*, uint32_t> equation_index{};
+
+        for (size_t c = 0; c < constraints.size(); ++c) {
+            const auto& eqns = problem.constraint_equations.at(constraints[c]);
+            constraint_records[c].first_equation = equations.size();
+            constraint_records[c].num_equations = eqns.size();
+
+            for (auto& eq : eqns) {
+                equation_index.emplace(eq, equations.size());
+                equations.push_back(
+                    {static_cast<uint32_t>(equation_variables.size()),
+                     static_cast<uint32_t>(eq->variables.size())});
+                for (auto& var : eq->variables) {
+                    equation_variables.push_back(variable_index.at(var));
+                }
+            }
+        }
+
+        // the graph numbers the equation sets
+        DependencyGraph graph{problem.equation_sets, problem.is_prereq_of};
+        for (auto& eqn_set : graph.equation_sets) {
+            equation_sets.push_back(
+                {static_cast<uint32_t>(set_equations.size()),
+                 static_cast<uint32_t>(eqn_set->equations.size()),
+                 eqn_set->solve_time});
+            for (auto& eq : eqn_set->equations) {
+                set_equations.push_back(equation_index.at(eq));
+            }
+        }
+        successor_offsets = graph.successor_offsets;
+        successors = graph.successors;
+    }
+
+    FileWriter writer{};
+    file::Header header{};
+    std::memcpy(header.magic, file::magic, sizeof(header.magic));
+    header.version = file::version;
+    header.flags = has_split ? file::has_split : 0;
+
+    header.strings = writer.append(strings.data());
+    header.values = writer.append(values);
+    header.geometries = writer.append(geometry_records);
+    header.constraints = writer.append(constraint_records);
+    header.arguments = writer.append(arguments);
+    header.parameters = writer.append(parameters);
+    header.equations = writer.append(equations);
+    header.equation_variables = writer.append(equation_variables);
+    header.equation_sets = writer.append(equation_sets);
+    header.set_equations = writer.append(set_equations);
+    header.successor_offsets = writer.append(successor_offsets);
+    header.successors = writer.append(successors);
+    writer.header() = header;
+
+    return writer.write(path);
+}
+
+bool MappedProblemFile::open(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st {};
+    void* mapping = MAP_FAILED;
+    if (fstat(fd, &st) == 0 &&
+        static_cast<size_t>(st.st_size) >= sizeof(file::Header)) {
+        mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    ::close(fd);
+
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    data = static_cast<const char*>(mapping);
+    size = st.st_size;
+
+    // type names are read in place, so the strings have to end with a null
+    // character
+    const auto& h = header();
+    const bool valid =
+        std::memcmp(h.magic, file::magic, sizeof(h.magic)) == 0 &&
+        h.version == file::version && fits<char>(h.strings, size) &&
+        (h.strings.count == 0 ||
+         data[h.strings.offset + h.strings.count - 1] == '\0') &&
+        fits<double>(h.values, size) &&
+        fits<file::GeometryRecord>(h.geometries, size) &&
+        fits<file::ConstraintRecord>(h.constraints, size) &&
+        fits<file::ArgumentRecord>(h.arguments, size) &&
+        fits<double>(h.parameters, size) &&
+        fits<file::EquationRecord>(h.equations, size) &&
+        fits<uint32_t>(h.equation_variables, size) &&
+        fits<file::EquationSetRecord>(h.equation_sets, size) &&
+        fits<uint32_t>(h.set_equations, size) &&
+        fits<uint32_t>(h.successor_offsets, size) &&
+        fits<uint32_t>(h.successors, size);
+
+    if (!valid) {
+        close();
+    }
+    return valid;
+}
+
+void MappedProblemFile::close() {
+    if (data) {
+        munmap(const_cast<char*>(data), size);
+        data = nullptr;
+        size = 0;
+    }
+}
+
+uptr<LoadedProblem> load_problem(const MappedProblemFile& file,
+                                 const TypeRegistry& registry) {
+    const auto& header = file.header();
+    const auto values = file.section<double>(header.values);
+    const auto num_variables = header.values.count;
+
+    uptr<LoadedProblem> result{new LoadedProblem{}};
+    auto& problem = result->problem;
+
+    // make the geometry, which owns most variables
+    std::vector<Variable*> variables(num_variables, nullptr);
+    std::vector<Geometry*> owners(num_variables, nullptr);
+
+    auto geometries = file.section<file::GeometryRecord>(header.geometries);
+    for (size_t g = 0; g < header.geometries.count; ++g) {
+        const auto& record = geometries[g];
+        if (record.type >= header.strings.count ||
+            !in_range(
+                record.first_variable, record.num_variables, header.values)) {
+            return nullptr;
+        }
+        auto factory = registry.geometries.find(file.string(record.type));
+        if (factory == registry.geometries.end()) {
+            return nullptr;
+        }
+
+        result->geometries.emplace_back(factory->second());
+        auto geom = result->geometries.back().get();
+        auto vars = geom->get_variables();
+        if (vars.size() != record.num_variables) {
+            return nullptr;
+        }
+
+        for (size_t k = 0; k < vars.size(); ++k) {
+            auto i = record.first_variable + k;
+            vars[k]->value = values[i];
+            variables[i] = vars[k];
+            owners[i] = geom;
+        }
+        problem.geoms.insert(geom);
+    }
+
+    for (size_t i = 0; i < num_variables; ++i) {
+        if (!variables[i]) {
+            result->variables.emplace_back(new Variable{values[i]});
+            variables[i] = result->variables.back().get();
+            problem.variables.insert(variables[i]);
+        }
+    }
+
+    // make the constraints from their arguments
+    auto constraints = file.section<file::ConstraintRecord>(header.constraints);
+    auto arguments = file.section<file::ArgumentRecord>(header.arguments);
+    auto parameters = file.section<double>(header.parameters);
+
+    for (size_t c = 0; c < header.constraints.count; ++c) {
+        const auto& record = constraints[c];
+        if (record.type >= header.strings.count ||
+            !in_range(record.first_argument,
+                      record.num_arguments,
+                      header.arguments) ||
+            !in_range(record.first_parameter,
+                      record.num_parameters,
+                      header.parameters)) {
+            return nullptr;
+        }
+        auto factory = registry.constraints.find(file.string(record.type));
+        if (factory == registry.constraints.end()) {
+            return nullptr;
+        }
+
+        ConstraintArguments args{};
+        args.parameters = parameters + record.first_parameter;
+        for (size_t k = 0; k < record.num_arguments; ++k) {
+            const auto& arg = arguments[record.first_argument + k];
+            if (arg.variable >= num_variables) {
+                return nullptr;
+            }
+
+            auto var = variables[arg.variable];
+            if (arg.type == file::none) {
+                args.geometries.push_back(nullptr);
+                args.variables.push_back(var);
+                continue;
+            }
+
+            auto owner = owners[arg.variable];
+            if (!owner || arg.type >= header.strings.count) {
+                return nullptr;
+            }
+            auto geom = owner->find_geometry(file.string(arg.type), var);
+            if (!geom) {
+                return nullptr;
+            }
+            args.geometries.push_back(geom);
+            args.variables.push_back(nullptr);
+        }
+
+        result->constraints.emplace_back(factory->second(args));
+        problem.constraints.insert(result->constraints.back().get());
+    }
+
+    if (!(header.flags & file::has_split)) {
+        problem.reset_to_single_equation_set();
+        return result;
+    }
+
+    // make the equations, and mark the variables they solve for
+    auto equation_records =
+        file.section<file::EquationRecord>(header.equations);
+    auto equation_variables =
+        file.section<uint32_t>(header.equation_variables);
+    std::vector<Equation*> equations{};
+
+    for (size_t c = 0; c < header.constraints.count; ++c) {
+        const auto& record = constraints[c];
+        auto constraint = result->constraints[c].get();
+        auto& eqns = problem.constraint_equations[constraint];
+        eqns = constraint->get_equations(problem.arena);
+        if (eqns.size() != record.num_equations ||
+            record.first_equation != equations.size()) {
+            return nullptr;
+        }
+        equations.insert(equations.end(), eqns.begin(), eqns.end());
+    }
+    if (equations.size() != header.equations.count) {
+        return nullptr;
+    }
+
+    // equations start out solving for all of their variables, so they're
+    // reduced to the stored variables, and (like after
+    // EquationSet::set_solved) each variable only keeps the equations that
+    // hold it constant
+    for (size_t e = 0; e < equations.size(); ++e) {
+        const auto& record = equation_records[e];
+        if (!in_range(record.first_variable,
+                      record.num_variables,
+                      header.equation_variables)) {
+            return nullptr;
+        }
+
+        auto eq = equations[e];
+        eq->variables.clear();
+        for (size_t k = 0; k < record.num_variables; ++k) {
+            auto i = equation_variables[record.first_variable + k];
+            if (i >= num_variables) {
+                return nullptr;
+            }
+            eq->variables.insert(variables[i]);
+            variables[i]->equations.erase(eq);
+        }
+    }
+
+    // make the equation sets and link them with the stored dependency graph
+    auto set_records =
+        file.section<file::EquationSetRecord>(header.equation_sets);
+    auto set_equations = file.section<uint32_t>(header.set_equations);
+    auto successor_offsets = file.section<uint32_t>(header.successor_offsets);
+    auto successors = file.section<uint32_t>(header.successors);
+    const auto num_sets = header.equation_sets.count;
+
+    if (header.successor_offsets.count != num_sets + 1 ||
+        successor_offsets[num_sets] != header.successors.count) {
+        return nullptr;
+    }
+
+    std::vector<EquationSet*> sets{};
+    for (size_t s = 0; s < num_sets; ++s) {
+        const auto& record = set_records[s];
+        if (!in_range(record.first_equation,
+                      record.num_equations,
+                      header.set_equations)) {
+            return nullptr;
+        }
+
+        auto eqn_set = problem.arena.equation_sets.make();
+        for (size_t k = 0; k < record.num_equations; ++k) {
+            auto e = set_equations[record.first_equation + k];
+            if (e >= equations.size()) {
+                return nullptr;
+            }
+            eqn_set->add_equation(*equations[e]);
+        }
+        eqn_set->solve_time = record.solve_time;
+
+        problem.equation_sets.insert(eqn_set);
+        problem.prereqs.emplace(eqn_set,
+                                decltype(problem.prereqs)::mapped_type{});
+        problem.is_prereq_of.emplace(
+            eqn_set, decltype(problem.is_prereq_of)::mapped_type{});
+        problem.index_equation_set(eqn_set);
+        sets.push_back(eqn_set);
+    }
+
+    for (size_t s = 0; s < num_sets; ++s) {
+        if (successor_offsets[s] > successor_offsets[s + 1]) {
+            return nullptr;
+        }
+        for (auto i = successor_offsets[s]; i < successor_offsets[s + 1]; ++i) {
+            if (successors[i] >= num_sets) {
+                return nullptr;
+            }
+            problem.is_prereq_of[sets[s]].insert(sets[successors[i]]);
+            problem.prereqs[sets[successors[i]]].insert(sets[s]);
+        }
+    }
+
+    problem.lay_out_values();
+    return result;
+}
+
+}  // namespace gcs
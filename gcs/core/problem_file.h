@@ -0,0 +1,245 @@
+#ifndef GCS_CORE_PROBLEM_FILE
+#define GCS_CORE_PROBLEM_FILE
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "gcs/core/constraints.h"
+#include "gcs/core/geometry.h"
+#include "gcs/core/problem.h"
+#include "gcs/core/solve_elements.h"
+
+namespace gcs {
+
+//! Layout of a problem file
+//!
+//! A problem file is a header followed by flat arrays of fixed size records
+//! (sections), each aligned to 8 bytes and stored in native byte order, so the
+//! file can be mapped into memory and read in place. Records refer to each
+//! other by index, and type names are offsets into the strings section.
+namespace file {
+
+//! "GCSPROB" followed by a null character
+constexpr char magic[8] = {'G', 'C', 'S', 'P', 'R', 'O', 'B', '\0'};
+constexpr uint32_t version = 1;
+
+//! Marks an index that refers to nothing
+constexpr uint32_t none = ~uint32_t{0};
+
+//! The header has this flag if the equation sets are stored
+constexpr uint32_t has_split = 1;
+
+//! An array of records
+struct Section {
+    //! Offset of the first record from the start of the file
+    uint64_t offset;
+    //! Number of records
+    uint64_t count;
+};
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+
+    //! Null terminated type names (char)
+    Section strings;
+    //! Value of each variable (double)
+    Section values;
+    //! Geometry that owns variables (GeometryRecord)
+    Section geometries;
+    //! Constraints, in the order their equations are stored
+    //! (ConstraintRecord)
+    Section constraints;
+    //! Arguments of the constraints (ArgumentRecord)
+    Section arguments;
+    //! Constants of the constraints (double)
+    Section parameters;
+    //! Equations of the constraints, in the order of
+    //! Constraint::get_equations (EquationRecord)
+    Section equations;
+    //! Variables that each equation solves for (uint32_t variable index)
+    Section equation_variables;
+    //! Equation sets, indexed by id (EquationSetRecord)
+    Section equation_sets;
+    //! Equations of each equation set (uint32_t equation index)
+    Section set_equations;
+    //! The dependency graph between equation sets, in the compressed sparse
+    //! row arrays of DependencyGraph (uint32_t)
+    Section successor_offsets;
+    Section successors;
+};
+
+//! A geometry that isn't a sub-component of another geometry
+//!
+//! The variables of a geometry are stored next to each other, in the order of
+//! Geometry::get_variables. Variables that aren't part of any geometry are
+//! standalone.
+struct GeometryRecord {
+    uint32_t type;
+    uint32_t first_variable;
+    uint32_t num_variables;
+    uint32_t reserved;
+};
+
+struct ConstraintRecord {
+    uint32_t type;
+    uint32_t first_argument;
+    uint32_t num_arguments;
+    uint32_t first_parameter;
+    uint32_t num_parameters;
+    uint32_t first_equation;
+    uint32_t num_equations;
+    uint32_t reserved;
+};
+
+//! A geometry (by its type and first variable) or a variable that a
+//! constraint is defined on
+struct ArgumentRecord {
+    //! Type name of the geometry, or none for a variable
+    uint32_t type;
+    uint32_t variable;
+};
+
+struct EquationRecord {
+    uint32_t first_variable;
+    uint32_t num_variables;
+};
+
+struct EquationSetRecord {
+    uint32_t first_equation;
+    uint32_t num_equations;
+    double solve_time;
+};
+
+}  // namespace file
+
+//! The arguments a constraint is made from when a problem is loaded
+//!
+//! Arguments are indexed in the order of Constraint::get_arguments, and
+//! parameters in the order of Constraint::get_parameters.
+struct ConstraintArguments {
+    //! The geometry of each argument (null for variables)
+    std::vector<Geometry*> geometries;
+    //! The variable of each argument (null for geometry)
+    std::vector<Variable*> variables;
+    const double* parameters = nullptr;
+
+    template <typename T>
+    T& geometry(size_t i) const {
+        return static_cast<T&>(*geometries[i]);
+    }
+
+    Variable& variable(size_t i) const { return *variables[i]; }
+
+    double parameter(size_t i) const { return parameters[i]; }
+};
+
+//! Makes geometry and constraints by their type names
+//!
+//! Each namespace of generated geometry and constraints has functions that
+//! add its types, such as gcs::g2d::register_geometry and
+//! gcs::g2d::register_constraints.
+struct TypeRegistry {
+    //! Makes a geometry, whose variables are set afterwards
+    using GeometryFactory = std::function<Geometry*()>;
+    using ConstraintFactory =
+        std::function<Constraint*(const ConstraintArguments&)>;
+
+    std::unordered_map<std::string, GeometryFactory> geometries;
+    std::unordered_map<std::string, ConstraintFactory> constraints;
+
+    void add_geometry(const std::string& type, GeometryFactory factory) {
+        geometries[type] = std::move(factory);
+    }
+
+    void add_constraint(const std::string& type, ConstraintFactory factory) {
+        constraints[type] = std::move(factory);
+    }
+};
+
+//! Writes a problem to a file
+//!
+//! The file holds every variable, geometry and constraint that the
+//! constraints use, along with the variables and geometry of the problem.
+//! Geometry is found through the constraints, so it doesn't need to be added
+//! to the problem. If the problem has been split (and presolve didn't
+//! eliminate any equations), the equation sets and the dependencies between
+//! them are stored too, so that the problem can be solved again after loading
+//! without splitting it.
+//!
+//! @param problem a problem without pending edits, whose geometry and
+//! constraints all have type names
+//! @param path the file to write
+//! @returns false if the problem can't be saved or the file can't be written
+bool save_problem(Problem& problem, const std::string& path);
+
+//! A problem file that is mapped into memory
+class MappedProblemFile {
+   public:
+    MappedProblemFile() = default;
+    ~MappedProblemFile() { close(); }
+
+    MappedProblemFile(const MappedProblemFile&) = delete;
+    MappedProblemFile& operator=(const MappedProblemFile&) = delete;
+
+    //! Maps a file into memory and checks its header
+    //!
+    //! @returns false if the file can't be mapped or isn't a problem file
+    bool open(const std::string& path);
+
+    //! Unmaps the file
+    void close();
+
+    const file::Header& header() const {
+        return *reinterpret_cast<const file::Header*>(data);
+    }
+
+    //! @returns the first record of a section
+    template <typename T>
+    const T* section(const file::Section& section) const {
+        return reinterpret_cast<const T*>(data + section.offset);
+    }
+
+    //! @returns a type name from the strings section
+    const char* string(uint32_t offset) const {
+        return section<char>(header().strings) + offset;
+    }
+
+   private:
+    const char* data = nullptr;
+    size_t size = 0;
+};
+
+//! A problem that was loaded from a file, along with the variables, geometry
+//! and constraints that were made for it
+struct LoadedProblem {
+    //! Variables that aren't part of any geometry
+    std::vector<uptr<Variable>> variables;
+    std::vector<uptr<Geometry>> geometries;
+    std::vector<uptr<Constraint>> constraints;
+
+    Problem problem;
+};
+
+//! Makes a problem from a mapped problem file
+//!
+//! Values are read straight from the mapped file. If the file has equation
+//! sets, they're made from the stored equation sets and dependency graph
+//! instead of by splitting, so the problem is ready to solve. Otherwise the
+//! problem is left with a single equation set, ready to split.
+//!
+//! @param file a mapped problem file
+//! @param registry the factories of every type of geometry and constraint in
+//! the file
+//! @returns the loaded problem, or null if the file refers to an unknown type
+//! or is inconsistent
+uptr<LoadedProblem> load_problem(const MappedProblemFile& file,
+                                 const TypeRegistry& registry);
+
+}  // namespace gcs
+
+#endif  // GCS_CORE_PROBLEM_FILE
@@ -17,7 +17,11 @@ void Variable::set_solved() {
 
 Equation::Equation(Equation&& equation)
     : variables{std::move(equation.variables)},
-      make_residual_ftor{std::move(equation.make_residual_ftor)} {
+      references{std::move(equation.references)},
+      make_residual_ftor{std::move(equation.make_residual_ftor)},
+      function{std::move(equation.function)},
+      arguments{std::move(equation.arguments)},
+      batch_kernel{equation.batch_kernel} {
     for (auto& var : this->variables) {
         var->equations.erase(&equation);
     }
@@ -26,18 +30,37 @@ Equation::Equation(Equation&& equation)
 }
 
 Equation::Equation(const decltype(variables)& vars,
-                   decltype(make_residual_ftor) make_residual_ftor)
-    : variables{vars}, make_residual_ftor{make_residual_ftor} {
+                   decltype(make_residual_ftor) make_residual_ftor,
+                   std::string function,
+                   decltype(arguments) arguments,
+                   BatchKernel batch_kernel)
+    : variables{vars},
+      make_residual_ftor{make_residual_ftor},
+      function{std::move(function)},
+      arguments{std::move(arguments)},
+      batch_kernel{batch_kernel} {
     this->init();
 }
 
 Equation::Equation(decltype(variables)&& vars,
-                   decltype(make_residual_ftor) make_residual_ftor)
-    : variables{vars}, make_residual_ftor{make_residual_ftor} {
+                   decltype(make_residual_ftor) make_residual_ftor,
+                   std::string function,
+                   decltype(arguments) arguments,
+                   BatchKernel batch_kernel)
+    : variables{vars},
+      make_residual_ftor{make_residual_ftor},
+      function{std::move(function)},
+      arguments{std::move(arguments)},
+      batch_kernel{batch_kernel} {
     this->init();
 }
 
 void Equation::init() {
+    if (this->references.empty()) {
+        this->references.assign(this->variables.begin(),
+                                this->variables.end());
+    }
+
     // register this equation with its variables
     for (auto& var : this->variables) {
         var->equations.insert(this);
@@ -147,13 +170,16 @@ size_t std::hash<gcs::EquationSet>::operator()(
     // references:
     // - hash function for vector: https://stackoverflow.com/a/27216842
     // - iteration over unordered set: https://stackoverflow.com/q/36242103
+    // - splitmix64 finalizer: https://prng.di.unimi.it/splitmix64.c
 
-    std::size_t seed = eqn_set.equations.size();
+    // each pointer is mixed before being combined, and the combination is a
+    // sum so that it doesn't depend on the order of iteration
+    uint64_t seed = eqn_set.equations.size();
     for (auto& eqn : eqn_set.equations) {
-        seed ^= reinterpret_cast<size_t>(eqn);
-        // // TODO: old hash function was dependent on random order of iteration
-        // seed ^= reinterpret_cast<size_t>(eqn) + 0x9e3779b9 + (seed << 6) +
-        //         (seed >> 2);
+        uint64_t z = reinterpret_cast<uintptr_t>(eqn) + 0x9e3779b97f4a7c15ull;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        seed += z ^ (z >> 31);
     }
-    return seed;
-};
+    return static_cast<size_t>(seed);
+}
@@ -3,12 +3,18 @@
 
 #include <ceres/ceres.h>
 
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <map>
 #include <memory>
 #include <queue>
 #include <set>
+#include <string>
 #include <unordered_set>
+#include <vector>
+
+#include "gcs/core/flat_set.h"
 
 namespace gcs {
 
@@ -19,6 +25,20 @@ struct Variable;
 struct Equation;
 struct EquationSet;
 
+//! Evaluates the residuals and jacobians of many equations with the same
+//! function at once
+//!
+//! The arguments are laid out by argument, so argument a of equation i is at
+//! arguments[a * count + i], and each equation has one residual, at
+//! residuals[i]. If jacobians is not null, it is laid out like the arguments,
+//! with the derivative of residual i by argument a at jacobians[a * count + i].
+//! Keeping each argument contiguous lets the loops over the equations be
+//! vectorized.
+using BatchKernel = void (*)(size_t count,
+                             const double* arguments,
+                             double* residuals,
+                             double* jacobians);
+
 //! A variable, which takes on a value and tracks the equations it appears in
 struct Variable {
     //! The value for this variable
@@ -30,7 +50,16 @@ struct Variable {
     //! After being split/solved: this set should contain all equations that
     //! require this variable to already be solved for and held constant until
     //! that equaiton can be used to solve for other variables.
+    //!
+    //! Hashed rather than a FlatSet, since a variable shared by many
+    //! constraints collects all of their equations.
     std::unordered_set<Equation*> equations;
+    //! Index of this variable in the graph it was last added to
+    //! @see ConstraintGraph
+    uint32_t id = 0;
+    //! Slot of this variable in the value store it was last added to
+    //! @see ValueStore
+    uint32_t slot = ~uint32_t{0};
 
     Variable() = default;
     Variable(double value);
@@ -53,20 +82,50 @@ struct Equation {
     //! After solving/splitting: contains only the variables that this equation
     //! solves for (not ones that should be held constant and were assumed
     //! solved earlier).
-    std::unordered_set<Variable*> variables;
+    FlatSet<Variable*> variables;
+    //! All variables that are used in this equation
+    //!
+    //! Unlike variables, this is not modified by splitting/solving, so it can
+    //! be used to restore an equation to its unsplit state.
+    std::vector<Variable*> references;
     //! Function that adds a residual block to a ceres Problem
     //!
     //! This function should add exactly one residual block to the problem. That
     //! residual block should only use the variables refrenced by this equation
     //! when it was created.
     std::function<void(ceres::Problem&)> make_residual_ftor;
+    //! Name of the constraint function that computes the residual, such as
+    //! "equate" (empty if unknown)
+    //!
+    //! Used to recognise equations that can be solved in closed form.
+    //! @see direct_solve
+    std::string function;
+    //! Pointers to the arguments of function, in the order they are passed
+    //!
+    //! Arguments are either the values of variables or constants owned by
+    //! the constraint.
+    std::vector<const double*> arguments;
+    //! Evaluates this equation together with other equations of the same
+    //! function, from its arguments (null if it can't be batched)
+    //!
+    //! @see FusedCostFunction
+    BatchKernel batch_kernel = nullptr;
+    //! Index of this equation in the graph it was last added to
+    //! @see ConstraintGraph
+    uint32_t id = 0;
 
     Equation(Equation&& equation);
 
     Equation(const decltype(variables)& vars,
-             decltype(make_residual_ftor) make_residual_ftor);
+             decltype(make_residual_ftor) make_residual_ftor,
+             std::string function = {},
+             decltype(arguments) arguments = {},
+             BatchKernel batch_kernel = nullptr);
     Equation(decltype(variables)&& vars,
-             decltype(make_residual_ftor) make_residual_ftor);
+             decltype(make_residual_ftor) make_residual_ftor,
+             std::string function = {},
+             decltype(arguments) arguments = {},
+             BatchKernel batch_kernel = nullptr);
 
     void init();
 };
@@ -77,6 +136,13 @@ struct EquationSet {
     //!
     //! Generally, an equation set does not take ownership of the equations
     std::unordered_set<Equation*> equations;
+    //! Index of this equation set in the graph it was last added to
+    //! @see DependencyGraph
+    uint32_t id = 0;
+    //! Time taken by the last solve of this equation set, in seconds (0 if it
+    //! hasn't been solved yet)
+    //! @see estimate_solve_costs
+    double solve_time = 0.0;
 
     ~EquationSet();
 
@@ -159,7 +225,7 @@ namespace std {
 
 //! Hash support for Eqn_set
 //!
-//! Note: this algorithm needs to be updated
+//! The hash does not depend on the iteration order of the equations
 template <>
 struct hash<gcs::EquationSet> {
     size_t operator()(const gcs::EquationSet& eqn_set) const;
@@ -1,101 +1,693 @@
 #include "gcs/core/split_equation_sets.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
 #include <vector>
 
+#include "gcs/core/constraint_graph.h"
 #include "gcs/core/solve_elements.h"
 
 namespace gcs {
 
-std::vector<EquationSet> split(EquationSet& equation_set) {
-    // set of split up equation sets - this will be returned
-    std::vector<EquationSet> solve_sets{};
+namespace {
+
+using Id = ConstraintGraph::Id;
+
+constexpr Id unmatched = std::numeric_limits<Id>::max();
+
+//! Hopcroft-Karp maximum matching between equations and variables
+//!
+//! Fills match_eqn (equation -> variable) and match_var (variable ->
+//! equation), using `unmatched` for unmatched vertices
+void maximum_matching(const ConstraintGraph& graph,
+                      std::vector<Id>& match_eqn,
+                      std::vector<Id>& match_var) {
+    const Id n_eqn = graph.num_equations();
+    const Id infinite = std::numeric_limits<Id>::max();
+
+    match_eqn.assign(n_eqn, unmatched);
+    match_var.assign(graph.num_variables(), unmatched);
+
+    // cheap greedy initial matching
+    for (Id e = 0; e < n_eqn; ++e) {
+        for (auto v : graph.variables_of(e)) {
+            if (match_var[v] == unmatched) {
+                match_eqn[e] = v;
+                match_var[v] = e;
+                break;
+            }
+        }
+    }
+
+    std::vector<Id> dist(n_eqn);
+    std::vector<Id> next_edge(n_eqn);
+    std::vector<Id> queue{};
+    std::vector<Id> stack{};
+
+    while (true) {
+        // breadth first search from all free equations to layer the graph
+        queue.clear();
+        for (Id e = 0; e < n_eqn; ++e) {
+            if (match_eqn[e] == unmatched) {
+                dist[e] = 0;
+                queue.push_back(e);
+            } else {
+                dist[e] = infinite;
+            }
+        }
+
+        bool found_free_var = false;
+        for (size_t i = 0; i < queue.size(); ++i) {
+            auto e = queue[i];
+            for (auto v : graph.variables_of(e)) {
+                auto e2 = match_var[v];
+                if (e2 == unmatched) {
+                    found_free_var = true;
+                } else if (dist[e2] == infinite) {
+                    dist[e2] = dist[e] + 1;
+                    queue.push_back(e2);
+                }
+            }
+        }
+
+        if (!found_free_var) {
+            break;
+        }
+
+        // depth first search along the layers for vertex-disjoint augmenting
+        // paths (iterative, so long chains can't overflow the stack)
+        std::fill(next_edge.begin(), next_edge.end(), 0);
+
+        for (Id root = 0; root < n_eqn; ++root) {
+            if (match_eqn[root] != unmatched) {
+                continue;
+            }
+
+            stack.assign(1, root);
+            while (!stack.empty()) {
+                auto e = stack.back();
+                auto edges = graph.variables_of(e);
+
+                if (next_edge[e] == edges.size()) {
+                    // dead end - don't visit this equation again this phase
+                    dist[e] = infinite;
+                    stack.pop_back();
+                    continue;
+                }
+
+                auto v = edges[next_edge[e]++];
+                auto e2 = match_var[v];
+
+                if (e2 == unmatched) {
+                    // augment along the path held in the stack
+                    for (auto e3 : stack) {
+                        auto v3 = graph.variables_of(e3)[next_edge[e3] - 1];
+                        match_eqn[e3] = v3;
+                        match_var[v3] = e3;
+                    }
+                    break;
+                }
+
+                if (dist[e2] == dist[e] + 1) {
+                    stack.push_back(e2);
+                }
+            }
+        }
+    }
+}
+
+}  // namespace
+
+Decomposition decompose(EquationSet& equation_set, Tracer* tracer) {
+    TraceSpan graph_span{tracer, "constraint graph", "split"};
+    ConstraintGraph graph{equation_set};
+    const Id n_eqn = graph.num_equations();
+    const Id n_var = graph.num_variables();
+    graph_span.end();
+
+    TraceSpan matching_span{tracer, "maximum matching", "split"};
+    std::vector<Id> match_eqn{};
+    std::vector<Id> match_var{};
+    maximum_matching(graph, match_eqn, match_var);
+    matching_span.end();
+
+    TraceSpan dm_span{tracer, "dulmage-mendelsohn", "split"};
+    // Dulmage-Mendelsohn coarse decomposition: anything reachable through an
+    // alternating path from a free variable is under-constrained, anything
+    // reachable through an alternating path from a free equation is
+    // over-constrained, and the rest is well-constrained
+    enum Part : unsigned char { well, under, over };
+    std::vector<Part> eqn_part(n_eqn, well);
+    std::vector<Part> var_part(n_var, well);
+    std::vector<Id> queue{};
+
+    for (Id v = 0; v < n_var; ++v) {
+        if (match_var[v] == unmatched) {
+            var_part[v] = under;
+            queue.push_back(v);
+        }
+    }
+    for (size_t i = 0; i < queue.size(); ++i) {
+        for (auto e : graph.equations_of(queue[i])) {
+            if (eqn_part[e] == well) {
+                eqn_part[e] = under;
+
+                auto v2 = match_eqn[e];
+                if (var_part[v2] == well) {
+                    var_part[v2] = under;
+                    queue.push_back(v2);
+                }
+            }
+        }
+    }
+
+    queue.clear();
+    for (Id e = 0; e < n_eqn; ++e) {
+        if (match_eqn[e] == unmatched) {
+            eqn_part[e] = over;
+            queue.push_back(e);
+        }
+    }
+    for (size_t i = 0; i < queue.size(); ++i) {
+        for (auto v : graph.variables_of(queue[i])) {
+            if (var_part[v] == well) {
+                var_part[v] = over;
+
+                auto e2 = match_var[v];
+                if (eqn_part[e2] == well) {
+                    eqn_part[e2] = over;
+                    queue.push_back(e2);
+                }
+            }
+        }
+    }
+
+    // block index of each equation, in solve order
+    std::vector<Id> eqn_block(n_eqn, unmatched);
+    Id n_blocks = 0;
+
+    Id over_block = unmatched;
+    for (Id e = 0; e < n_eqn; ++e) {
+        if (eqn_part[e] == over) {
+            over_block = 0;
+            n_blocks = 1;
+            break;
+        }
+    }
+
+    dm_span.end();
+
+    // Tarjan's algorithm on the well-constrained equations, where equation e
+    // depends on the equation that is matched to each of its other variables.
+    // Components are emitted dependencies first, which is the solve order.
+    {
+        TraceSpan tarjan_span{tracer, "strongly connected components", "split"};
+        const Id unvisited = std::numeric_limits<Id>::max();
+        std::vector<Id> index(n_eqn, unvisited);
+        std::vector<Id> lowlink(n_eqn, 0);
+        std::vector<bool> on_stack(n_eqn, false);
+        std::vector<Id> next_edge(n_eqn, 0);
+        std::vector<Id> scc_stack{};
+        std::vector<Id> call_stack{};
+        Id counter = 0;
+
+        for (Id root = 0; root < n_eqn; ++root) {
+            if (eqn_part[root] != well || index[root] != unvisited) {
+                continue;
+            }
+
+            call_stack.push_back(root);
+            while (!call_stack.empty()) {
+                auto e = call_stack.back();
+
+                if (index[e] == unvisited) {
+                    index[e] = lowlink[e] = counter++;
+                    scc_stack.push_back(e);
+                    on_stack[e] = true;
+                }
+
+                bool descended = false;
+                auto edges = graph.variables_of(e);
+                while (next_edge[e] < edges.size()) {
+                    auto e2 = match_var[edges[next_edge[e]++]];
+                    if (e2 == e || eqn_part[e2] != well) {
+                        continue;
+                    }
+
+                    if (index[e2] == unvisited) {
+                        call_stack.push_back(e2);
+                        descended = true;
+                        break;
+                    }
+                    if (on_stack[e2]) {
+                        lowlink[e] = std::min(lowlink[e], index[e2]);
+                    }
+                }
+                if (descended) {
+                    continue;
+                }
+
+                call_stack.pop_back();
+                if (!call_stack.empty()) {
+                    auto parent = call_stack.back();
+                    lowlink[parent] = std::min(lowlink[parent], lowlink[e]);
+                }
+
+                if (lowlink[e] == index[e]) {
+                    // e is the root of a strongly connected component
+                    Id e2;
+                    do {
+                        e2 = scc_stack.back();
+                        scc_stack.pop_back();
+                        on_stack[e2] = false;
+                        eqn_block[e2] = n_blocks;
+                    } while (e2 != e);
+                    ++n_blocks;
+                }
+            }
+        }
+    }
+
+    TraceSpan sets_span{tracer, "equation sets", "split"};
+    Id under_block = unmatched;
+    for (Id e = 0; e < n_eqn; ++e) {
+        if (eqn_part[e] == over) {
+            eqn_block[e] = over_block;
+        } else if (eqn_part[e] == under) {
+            if (under_block == unmatched) {
+                under_block = n_blocks++;
+            }
+            eqn_block[e] = under_block;
+        }
+    }
+
+    // each variable is solved by the block of its matched equation
+    // (free variables can only be in the under-constrained block)
+    std::vector<Id> var_block(n_var);
+    for (Id v = 0; v < n_var; ++v) {
+        var_block[v] =
+            match_var[v] == unmatched ? under_block : eqn_block[match_var[v]];
+    }
+
+    Decomposition result{};
+    result.equation_sets.resize(n_blocks);
+    result.prereqs.resize(n_blocks);
+
+    for (Id e = 0; e < n_eqn; ++e) {
+        auto block = eqn_block[e];
+        result.equation_sets[block].add_equation(*graph.equations[e]);
+
+        for (auto v : graph.variables_of(e)) {
+            if (var_block[v] != block) {
+                result.prereqs[block].push_back(var_block[v]);
+            }
+        }
+    }
+
+    // several equations of a block may depend on the same block
+    for (auto& deps : result.prereqs) {
+        std::sort(deps.begin(), deps.end());
+        deps.erase(std::unique(deps.begin(), deps.end()), deps.end());
+    }
+
+    for (auto& eqn_set : result.equation_sets) {
+        eqn_set.set_solved();
+    }
+
+    return result;
+}
+
+std::vector<EquationSet> split(EquationSet& equation_set,
+                               SplitMethod method,
+                               Tracer* tracer) {
+    if (method == SplitMethod::frontier_search) {
+        TraceSpan span{tracer, "frontier search", "split"};
+        return split_frontier_search(equation_set);
+    }
+
+    return std::move(decompose(equation_set, tracer).equation_sets);
+}
+
+namespace {
+
+//! A candidate equation set in the frontier search
+//!
+//! The sorted equation ids of a candidate are stored in a pool shared by all
+//! candidates, and the number of variables and hash are cached, so creating
+//! and comparing candidates doesn't allocate.
+struct Candidate {
+    //! Position of the first equation id in the pool
+    uint32_t offset;
+    //! Number of equations
+    uint32_t size;
+    //! Number of unsolved variables used by the equations
+    uint32_t num_variables;
+    //! Zobrist hash of the equation ids
+    uint64_t hash;
+
+    int degrees_of_freedom() const {
+        return static_cast<int>(num_variables) - static_cast<int>(size);
+    }
+};
+
+//! Random key for an equation id, xor-ed together to hash a candidate
+uint64_t zobrist_key(Id eqn) {
+    // splitmix64
+    uint64_t z = eqn + 0x9e3779b97f4a7c15ull;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+//! Best-first search for constrained equation sets
+//!
+//! The state of the search is kept in flat arrays indexed by the ids of a
+//! ConstraintGraph. Equations that belong to a found set are flagged as
+//! removed and their variables as solved instead of modifying the
+//! equations themselves.
+class FrontierSearch {
+   public:
+    explicit FrontierSearch(const ConstraintGraph& graph)
+        : graph{graph},
+          eqn_removed(graph.num_equations(), false),
+          var_solved(graph.num_variables(), false),
+          eqn_stamp(graph.num_equations(), 0),
+          var_stamp(graph.num_variables(), 0) {}
+
+    //! Runs the search
+    //!
+    //! @returns the equation ids of each constrained set in the order they
+    //! were found, followed by the leftover equations (if any)
+    std::vector<std::vector<Id>> run() {
+        std::vector<std::vector<Id>> found{};
+
+        // initialize with single-equation sets
+        for (Id e = 0; e < graph.num_equations(); ++e) {
+            auto idx = add_candidate(&e, 1, zobrist_key(e));
+            visit(idx);
+            push(idx);
+        }
+
+        while (!heap.empty()) {
+            std::pop_heap(heap.begin(), heap.end(), compare());
+            auto current = candidates[heap.back()];
+            heap.pop_back();
+
+            if (current.degrees_of_freedom() == 0) {
+                found.emplace_back(pool.begin() + current.offset,
+                                   pool.begin() + current.offset + current.size);
+                mark_solved(found.back());
+                rebuild();
+            } else {
+                expand(current);
+            }
+        }
+
+        // leftover equations form the unconstrained set
+        std::vector<Id> leftover{};
+        for (Id e = 0; e < graph.num_equations(); ++e) {
+            if (!eqn_removed[e]) {
+                leftover.push_back(e);
+            }
+        }
+        if (!leftover.empty()) {
+            found.push_back(std::move(leftover));
+        }
+
+        return found;
+    }
+
+   private:
+    const ConstraintGraph& graph;
+
+    std::vector<bool> eqn_removed;
+    std::vector<bool> var_solved;
+
+    //! Scratch marks, valid when equal to the current stamp
+    std::vector<uint32_t> eqn_stamp;
+    std::vector<uint32_t> var_stamp;
+    uint32_t stamp = 0;
+
+    std::vector<Id> pool{};
+    std::vector<Candidate> candidates{};
+    //! Binary heap of candidate indices, closest to constrained on top
+    std::vector<uint32_t> heap{};
+    //! Open addressing hash table of visited candidate indices (plus one, so
+    //! that zero marks an empty slot)
+    std::vector<uint32_t> visited = std::vector<uint32_t>(64, 0);
+    size_t num_visited = 0;
+
+    //! Greater than compare: first by degrees of freedom, then by number of
+    //! variables (so the heap top has the fewest)
+    struct Compare {
+        const std::vector<Candidate>* candidates;
+
+        bool operator()(uint32_t a, uint32_t b) const {
+            auto& ca = (*candidates)[a];
+            auto& cb = (*candidates)[b];
+
+            if (ca.degrees_of_freedom() == cb.degrees_of_freedom()) {
+                return ca.num_variables > cb.num_variables;
+            }
+            return ca.degrees_of_freedom() > cb.degrees_of_freedom();
+        }
+    };
+
+    Compare compare() const { return Compare{&candidates}; }
+
+    void push(uint32_t idx) {
+        heap.push_back(idx);
+        std::push_heap(heap.begin(), heap.end(), compare());
+    }
+
+    void next_stamp() {
+        if (++stamp == 0) {
+            std::fill(eqn_stamp.begin(), eqn_stamp.end(), 0);
+            std::fill(var_stamp.begin(), var_stamp.end(), 0);
+            stamp = 1;
+        }
+    }
+
+    //! Copies sorted equation ids into the pool as a new candidate
+    uint32_t add_candidate(const Id* eqns, uint32_t size, uint64_t hash) {
+        Candidate candidate{static_cast<uint32_t>(pool.size()), size, 0, hash};
+        pool.insert(pool.end(), eqns, eqns + size);
 
-    // keeper of eqn sets generated in this function
-    std::unordered_set<EquationSet> visited_equation_sets{};
+        next_stamp();
+        for (uint32_t i = 0; i < size; ++i) {
+            for (auto v : graph.variables_of(eqns[i])) {
+                if (!var_solved[v] && var_stamp[v] != stamp) {
+                    var_stamp[v] = stamp;
+                    ++candidate.num_variables;
+                }
+            }
+        }
 
-    // priority queue where pop returns the equation set
-    // that is "closest" to being solvable
-    std::priority_queue<EquationSet,
-                        std::vector<EquationSet>,
-                        EquationSet::Compare>
-        pq{};
+        candidates.push_back(candidate);
+        return candidates.size() - 1;
+    }
 
-    // unconstrained equation set of leftover equations
-    EquationSet unconstrained_equation_set{equation_set.equations};
+    //! @returns true if candidate a has the same equations as b plus eqn
+    bool equals_extended(const Candidate& a, const Candidate& b, Id eqn) const {
+        if (a.hash != (b.hash ^ zobrist_key(eqn)) || a.size != b.size + 1) {
+            return false;
+        }
 
-    // initialize the pq with single-equation sets
-    for (auto& eqn : equation_set.equations) {
-        auto eqn_set = EquationSet{}.add_equation(*eqn);
+        uint32_t j = 0;
+        bool inserted = false;
+        for (uint32_t i = 0; i < a.size; ++i) {
+            Id expected;
+            if (!inserted && (j == b.size || eqn < pool[b.offset + j])) {
+                expected = eqn;
+                inserted = true;
+            } else {
+                expected = pool[b.offset + j++];
+            }
 
-        visited_equation_sets.emplace(eqn_set);
-        pq.push(std::move(eqn_set));
+            if (pool[a.offset + i] != expected) {
+                return false;
+            }
+        }
+        return true;
     }
 
-    while (!pq.empty()) {
-        auto current_equation_set = std::move(pq.top());
-        pq.pop();
+    //! Finds the visited slot for the candidate b plus eqn
+    //!
+    //! @returns the slot, which is empty if the candidate wasn't visited
+    size_t find_visited(const Candidate& b, Id eqn) const {
+        const size_t mask = visited.size() - 1;
+        auto hash = b.hash ^ zobrist_key(eqn);
 
-        if (current_equation_set.is_constrained()) {
-            // empty the pq - all of its entries need to be updated
-            std::vector<EquationSet> temp_eqn_sets{};
+        for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+            if (visited[slot] == 0 ||
+                equals_extended(candidates[visited[slot] - 1], b, eqn)) {
+                return slot;
+            }
+        }
+    }
 
-            while (!pq.empty()) {
-                // remove from the pq
-                auto eqn_set = std::move(pq.top());
-                pq.pop();
+    void visit(uint32_t idx) {
+        if (2 * (num_visited + 1) > visited.size()) {
+            // grow and rehash
+            std::vector<uint32_t> old{};
+            old.swap(visited);
+            visited.assign(2 * old.size(), 0);
+            num_visited = 0;
 
-                // remove all equations in the just-solved equation
-                // set from all equation sets in the pq
-                for (auto& equation : current_equation_set.equations) {
-                    eqn_set.equations.erase(equation);
+            for (auto entry : old) {
+                if (entry != 0) {
+                    insert_visited(entry - 1);
                 }
+            }
+        }
+        insert_visited(idx);
+    }
+
+    void insert_visited(uint32_t idx) {
+        const size_t mask = visited.size() - 1;
+        size_t slot = candidates[idx].hash & mask;
+        while (visited[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        visited[slot] = idx + 1;
+        ++num_visited;
+    }
 
-                // place in the temp vector - which will all be added to
-                // the pq after all updates have happened
-                // note: don't add back to pq if there are no equations left
-                if (!eqn_set.equations.empty()) {
-                    temp_eqn_sets.push_back(std::move(eqn_set));
+    //! Adds all unvisited candidates adjacent to the current one
+    void expand(const Candidate& current) {
+        // mark the equations and variables of the current candidate
+        next_stamp();
+        const auto mark = stamp;
+        for (uint32_t i = 0; i < current.size; ++i) {
+            auto e = pool[current.offset + i];
+            eqn_stamp[e] = mark;
+            for (auto v : graph.variables_of(e)) {
+                var_stamp[v] = mark;
+            }
+        }
+
+        // the frontier consists of all equations touching the variables of
+        // the current candidate
+        for (uint32_t i = 0; i < current.size; ++i) {
+            for (auto v : graph.variables_of(pool[current.offset + i])) {
+                if (var_solved[v]) {
+                    continue;
+                }
+
+                for (auto e : graph.equations_of(v)) {
+                    if (eqn_removed[e] || eqn_stamp[e] == mark) {
+                        continue;
+                    }
+                    eqn_stamp[e] = mark;
+
+                    auto slot = find_visited(current, e);
+                    if (visited[slot] != 0) {
+                        continue;
+                    }
+
+                    auto idx = extend(current, e, mark);
+                    visit(idx);
+                    push(idx);
                 }
             }
+        }
+    }
 
-            // remove equations from unconstrained set
-            for (auto& equation : current_equation_set.equations) {
-                unconstrained_equation_set.equations.erase(equation);
+    //! Creates the candidate made of another candidate plus one equation
+    //!
+    //! The variables of the base candidate must be marked with mark
+    uint32_t extend(const Candidate& base, Id eqn, uint32_t mark) {
+        Candidate candidate{static_cast<uint32_t>(pool.size()),
+                            base.size + 1,
+                            base.num_variables,
+                            base.hash ^ zobrist_key(eqn)};
+
+        // merge the equation into the sorted ids (by index, since the pool
+        // may be reallocated)
+        pool.resize(pool.size() + candidate.size);
+        uint32_t j = 0;
+        bool inserted = false;
+        for (uint32_t i = 0; i < candidate.size; ++i) {
+            if (!inserted && (j == base.size || eqn < pool[base.offset + j])) {
+                pool[candidate.offset + i] = eqn;
+                inserted = true;
+            } else {
+                pool[candidate.offset + i] = pool[base.offset + j++];
             }
+        }
 
-            // move this set to solve sets
-            current_equation_set.set_solved();
-            solve_sets.push_back(std::move(
-                current_equation_set));  // TODO: note move happening here
+        for (auto v : graph.variables_of(eqn)) {
+            if (!var_solved[v] && var_stamp[v] != mark) {
+                ++candidate.num_variables;
+            }
+        }
+
+        candidates.push_back(candidate);
+        return candidates.size() - 1;
+    }
 
-            // repopulate the pq
-            for (auto& eqn_set : temp_eqn_sets) {
-                pq.push(std::move(eqn_set));
+    void mark_solved(const std::vector<Id>& eqns) {
+        for (auto e : eqns) {
+            eqn_removed[e] = true;
+            for (auto v : graph.variables_of(e)) {
+                var_solved[v] = true;
             }
+        }
+    }
 
-            // reset visited equation sets
-            visited_equation_sets.clear();
-        } else {
-            // add all equation sets in the frontier to the pq
-            for (auto& eqn_set : current_equation_set.frontier()) {
-                auto result = visited_equation_sets.insert(std::move(eqn_set));
+    //! Removes solved equations from all queued candidates and forgets the
+    //! visited candidates
+    void rebuild() {
+        std::vector<Id> old_pool{};
+        std::vector<Candidate> old_candidates{};
+        std::vector<uint32_t> old_heap{};
+        old_pool.swap(pool);
+        old_candidates.swap(candidates);
+        old_heap.swap(heap);
 
-                // only add an equation set if it hasn't been
-                // visited yet
-                if (result.second) {
-                    pq.push(*result.first);
+        std::vector<Id> eqns{};
+        for (auto idx : old_heap) {
+            auto& candidate = old_candidates[idx];
+
+            eqns.clear();
+            uint64_t hash = 0;
+            for (uint32_t i = 0; i < candidate.size; ++i) {
+                auto e = old_pool[candidate.offset + i];
+                if (!eqn_removed[e]) {
+                    eqns.push_back(e);
+                    hash ^= zobrist_key(e);
                 }
             }
+
+            // don't add back to the queue if there are no equations left
+            if (!eqns.empty()) {
+                heap.push_back(add_candidate(eqns.data(), eqns.size(), hash));
+            }
         }
+        std::make_heap(heap.begin(), heap.end(), compare());
+
+        std::fill(visited.begin(), visited.end(), 0);
+        num_visited = 0;
     }
+};
+
+}  // namespace
+
+std::vector<EquationSet> split_frontier_search(EquationSet& equation_set) {
+    ConstraintGraph graph{equation_set};
+
+    // set of split up equation sets - this will be returned
+    std::vector<EquationSet> solve_sets{};
+
+    for (auto& eqns : FrontierSearch{graph}.run()) {
+        solve_sets.emplace_back();
+        for (auto e : eqns) {
+            solve_sets.back().add_equation(*graph.equations[e]);
+        }
 
-    // only add the unconstrained set if it isn't empty
-    // TODO: break up into smaller independent groups (?)
-    // TODO: unconstrained set could be last thing popped from pq (unless move
-    // happened last)
-    if (!unconstrained_equation_set.equations.empty()) {
-        unconstrained_equation_set.set_solved();
-        solve_sets.push_back(std::move(unconstrained_equation_set));
+        // mark as solved in the order the sets were found
+        solve_sets.back().set_solved();
     }
 
     return solve_sets;
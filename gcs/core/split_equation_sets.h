@@ -4,10 +4,67 @@
 #include <vector>
 
 #include "gcs/core/solve_elements.h"
+#include "gcs/core/telemetry.h"
 
 namespace gcs {
 
-std::vector<EquationSet> split(EquationSet& equation_set);
+//! Algorithm used to split an equation set into constrained subsets
+enum class SplitMethod {
+    //! Maximum matching followed by a Dulmage-Mendelsohn / strongly connected
+    //! component decomposition into block triangular form
+    block_triangular,
+    //! Priority-queue search that grows candidate sets through
+    //! EquationSet::frontier() until they become constrained
+    frontier_search,
+};
+
+//! Result of decomposing an equation set
+struct Decomposition {
+    //! The split equation sets, in an order in which they can be solved
+    std::vector<EquationSet> equation_sets;
+    //! For each equation set, the indices of the equation sets that must be
+    //! solved before it (indices always refer to earlier equation sets)
+    std::vector<std::vector<size_t>> prereqs;
+};
+
+//! Decompose an equation set into block triangular form
+//!
+//! Computes a maximum matching between the equations and the variables of the
+//! set, then uses the Dulmage-Mendelsohn decomposition to separate the
+//! over-constrained part, the well-constrained part and the under-constrained
+//! part. The well-constrained part is broken into its strongly connected
+//! components with Tarjan's algorithm, each of which becomes one constrained
+//! equation set.
+//!
+//! Sets are ordered as: the over-constrained set (if any), the constrained
+//! sets in dependency order, then the under-constrained set (if any). Each
+//! returned set is marked as solved.
+//!
+//! @param equation_set the equation set to decompose
+//! @param tracer if set, a span is added for each step of the decomposition
+//! @returns the split equation sets along with their dependencies
+Decomposition decompose(EquationSet& equation_set, Tracer* tracer = nullptr);
+
+//! Split an equation set using a best-first search over the frontier of
+//! candidate equation sets
+//!
+//! This is the original splitting heuristic, kept available for comparison
+//! with decompose().
+//!
+//! @param equation_set the equation set to split
+//! @returns the split equation sets, each marked as solved
+std::vector<EquationSet> split_frontier_search(EquationSet& equation_set);
+
+//! Split an equation set into smaller constrained equation sets
+//!
+//! @param equation_set the equation set to split
+//! @param method the splitting algorithm to use
+//! @param tracer if set, a span is added for each step of the split
+//! @returns the split equation sets, each marked as solved
+std::vector<EquationSet> split(
+    EquationSet& equation_set,
+    SplitMethod method = SplitMethod::block_triangular,
+    Tracer* tracer = nullptr);
 
 }  // namespace gcs
 
@@ -0,0 +1,143 @@
+#include "gcs/core/telemetry.h"
+
+#include <fstream>
+#include <iomanip>
+
+namespace gcs {
+
+namespace {
+
+//! Writes a string as a JSON string literal
+void write_string(std::ostream& out, const std::string& str) {
+    out << '"';
+    for (auto c : str) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out << ' ';
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+}  // namespace
+
+Tracer::Tracer() : origin{Clock::now()} {}
+
+void Tracer::add_span(const std::string& name,
+                      const char* category,
+                      Clock::time_point start,
+                      Clock::time_point end,
+                      std::thread::id thread,
+                      const std::string& args) {
+    std::lock_guard<std::mutex> lock{mutex};
+    events.push_back({name,
+                      category,
+                      'X',
+                      microseconds(start),
+                      microseconds(end) - microseconds(start),
+                      thread_index(thread),
+                      0,
+                      args});
+}
+
+void Tracer::add_flow(Clock::time_point from,
+                      std::thread::id from_thread,
+                      Clock::time_point to,
+                      std::thread::id to_thread) {
+    std::lock_guard<std::mutex> lock{mutex};
+    auto flow = num_flows++;
+    events.push_back({"dependency",
+                      "solve",
+                      's',
+                      microseconds(from),
+                      0.0,
+                      thread_index(from_thread),
+                      flow,
+                      {}});
+    events.push_back({"dependency",
+                      "solve",
+                      'f',
+                      microseconds(to),
+                      0.0,
+                      thread_index(to_thread),
+                      flow,
+                      {}});
+}
+
+bool Tracer::write(const std::string& path) const {
+    std::ofstream out{path};
+    if (!out) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock{mutex};
+    out << std::fixed << std::setprecision(3);
+    out << "{\"traceEvents\": [\n";
+
+    // name the track of each thread
+    bool first = true;
+    for (auto& thread : threads) {
+        out << (first ? "" : ",\n")
+            << "{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": 1, "
+            << "\"tid\": " << thread.second
+            << ", \"args\": {\"name\": \"thread " << thread.second << "\"}}";
+        first = false;
+    }
+
+    for (auto& event : events) {
+        out << (first ? "" : ",\n") << "{\"ph\": \"" << event.phase
+            << "\", \"name\": ";
+        write_string(out, event.name);
+        out << ", \"cat\": \"" << event.category << "\", \"pid\": 1"
+            << ", \"tid\": " << event.thread << ", \"ts\": " << event.timestamp;
+
+        if (event.phase == 'X') {
+            out << ", \"dur\": " << event.duration;
+            if (!event.args.empty()) {
+                out << ", \"args\": {" << event.args << "}";
+            }
+        } else {
+            // arrows end at the span that encloses their end
+            out << ", \"id\": " << event.flow
+                << (event.phase == 'f' ? ", \"bp\": \"e\"" : "");
+        }
+        out << "}";
+        first = false;
+    }
+
+    out << "\n],\n\"displayTimeUnit\": \"ms\"}\n";
+    return static_cast<bool>(out);
+}
+
+void Tracer::clear() {
+    std::lock_guard<std::mutex> lock{mutex};
+    events.clear();
+    num_flows = 0;
+}
+
+uint32_t Tracer::thread_index(std::thread::id thread) {
+    return threads.emplace(thread, threads.size()).first->second;
+}
+
+double Tracer::microseconds(Clock::time_point time) const {
+    return std::chrono::duration<double, std::micro>(time - origin).count();
+}
+
+TraceSpan::TraceSpan(Tracer* tracer, const char* name, const char* category)
+    : tracer{tracer}, name{name}, category{category} {
+    if (tracer) {
+        start = Tracer::Clock::now();
+    }
+}
+
+void TraceSpan::end() {
+    if (tracer) {
+        tracer->add_span(name, category, start, Tracer::Clock::now());
+        tracer = nullptr;
+    }
+}
+
+}  // namespace gcs
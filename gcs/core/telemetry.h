@@ -0,0 +1,157 @@
+#ifndef GCS_CORE_TELEMETRY
+#define GCS_CORE_TELEMETRY
+
+#include <ceres/ceres.h>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "gcs/core/solve_elements.h"
+
+namespace gcs {
+
+//! What happened when one equation set was solved
+//!
+//! Times are in seconds.
+struct SolveRecord {
+    //! The equation set that was solved
+    const EquationSet* eqn_set = nullptr;
+    //! Number of equations in the equation set
+    size_t num_equations = 0;
+    //! True if the equation set was solved in closed form, without ceres
+    //! @see direct_solve
+    bool direct = false;
+    //! Time from the start of the solve until this equation set started
+    //! solving
+    double start_time = 0.0;
+    //! Time this equation set waited for a runner after its prerequisites
+    //! were solved
+    double queue_wait = 0.0;
+    //! Time taken to solve this equation set
+    double solve_time = 0.0;
+    //! Number of ceres iterations (0 if solved in closed form)
+    int iterations = 0;
+    //! Cost before and after ceres ran (0 if solved in closed form)
+    double initial_cost = 0.0;
+    double final_cost = 0.0;
+    //! Why ceres stopped (CONVERGENCE if solved in closed form)
+    ceres::TerminationType termination_type = ceres::CONVERGENCE;
+    //! The thread that solved the equation set
+    std::thread::id thread{};
+};
+
+//! Receives the record of each equation set of a solve
+//!
+//! The records are delivered on the thread that called solve, once all
+//! equation sets are solved, in the order they started solving.
+using TelemetrySink = std::function<void(const SolveRecord&)>;
+
+//! Collects a timeline of spans, which is written as Chrome trace event JSON
+//!
+//! The file can be opened in chrome://tracing or https://ui.perfetto.dev,
+//! which show the spans of each thread on their own track. Spans can be added
+//! from any thread at the same time.
+//!
+//! @see Problem::tracer
+class Tracer {
+   public:
+    using Clock = std::chrono::steady_clock;
+
+    Tracer();
+
+    //! Adds a span
+    //!
+    //! @param name the name of the span
+    //! @param category the category of the span, such as "split" or "solve"
+    //! @param start when the span started
+    //! @param end when the span ended
+    //! @param thread the thread the span happened on
+    //! @param args members of a JSON object with details of the span, such as
+    //! "\"equations\": 3" (empty if there are none)
+    void add_span(const std::string& name,
+                  const char* category,
+                  Clock::time_point start,
+                  Clock::time_point end,
+                  std::thread::id thread = std::this_thread::get_id(),
+                  const std::string& args = {});
+
+    //! Adds an arrow between two spans, such as from an equation set to an
+    //! equation set that depends on it
+    //!
+    //! @param from a time within the span that the arrow starts from
+    //! @param from_thread the thread of that span
+    //! @param to the start of the span that the arrow points to
+    //! @param to_thread the thread of that span
+    void add_flow(Clock::time_point from,
+                  std::thread::id from_thread,
+                  Clock::time_point to,
+                  std::thread::id to_thread);
+
+    //! Writes all events so far to a file
+    //!
+    //! @returns false if the file can't be written
+    bool write(const std::string& path) const;
+
+    //! Removes all events
+    void clear();
+
+   private:
+    struct Event {
+        std::string name;
+        const char* category;
+        //! Chrome trace event phase: 'X' for a span, 's' and 'f' for the
+        //! start and end of an arrow
+        char phase;
+        //! Microseconds since the tracer was made
+        double timestamp;
+        double duration;
+        uint32_t thread;
+        uint64_t flow;
+        std::string args;
+    };
+
+    //! @returns the index of a thread, which is its track in the trace
+    uint32_t thread_index(std::thread::id thread);
+
+    double microseconds(Clock::time_point time) const;
+
+    const Clock::time_point origin;
+
+    mutable std::mutex mutex;
+    std::vector<Event> events{};
+    std::unordered_map<std::thread::id, uint32_t> threads{};
+    uint64_t num_flows = 0;
+};
+
+//! Adds a span to a tracer from construction until end() is called or the
+//! span is destroyed
+//!
+//! Does nothing if the tracer is null, so spans can be left in place when
+//! tracing is off.
+class TraceSpan {
+   public:
+    TraceSpan(Tracer* tracer, const char* name, const char* category);
+    ~TraceSpan() { end(); }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    //! Ends the span early
+    void end();
+
+   private:
+    Tracer* tracer;
+    const char* name;
+    const char* category;
+    Tracer::Clock::time_point start{};
+};
+
+}  // namespace gcs
+
+#endif  // GCS_CORE_TELEMETRY
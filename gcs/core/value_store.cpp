@@ -0,0 +1,161 @@
+#include "gcs/core/value_store.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace gcs {
+
+constexpr ValueStore::Slot ValueStore::none;
+constexpr ValueStore::Slot ValueStore::page_size;
+
+ValueStore::ValueStore() : variables{new std::vector<Variable*>{}} {}
+
+ValueStore::Slot ValueStore::add(Variable* var) {
+    if (contains(var)) {
+        return var->slot;
+    }
+
+    // the variables may be shared with a snapshot
+    if (variables.use_count() > 1) {
+        variables.reset(new std::vector<Variable*>{*variables});
+    }
+
+    var->slot = values.size();
+    values.push_back(var->value);
+    variables->push_back(var);
+    slots.emplace(&var->value, var->slot);
+
+    changed.resize(var->slot / page_size + 1, false);
+    mark_changed(var->slot);
+    return var->slot;
+}
+
+void ValueStore::clear() {
+    values.clear();
+    variables.reset(new std::vector<Variable*>{});
+    slots.clear();
+
+    pages.reset();
+    changed.clear();
+    any_changed = false;
+}
+
+ValueStore::Slot ValueStore::slot(const double* value) const {
+    auto it = slots.find(value);
+    return it == slots.end() ? none : it->second;
+}
+
+double* ValueStore::find(const double* value) {
+    auto s = slot(value);
+    return s == none ? nullptr : &values[s];
+}
+
+void ValueStore::gather() {
+    for (size_t i = 0; i < values.size(); ++i) {
+        auto value = (*variables)[i]->value;
+        if (values[i] != value) {
+            values[i] = value;
+            mark_changed(i);
+        }
+    }
+}
+
+size_t ValueSnapshot::num_shared_pages(const ValueSnapshot& other) const {
+    size_t num_shared = 0;
+    for (size_t p = 0; p < std::min(num_pages(), other.num_pages()); ++p) {
+        num_shared += (*pages)[p] == (*other.pages)[p];
+    }
+    return num_shared;
+}
+
+ValueSnapshot ValueStore::snapshot() {
+    const size_t num_pages = changed.size();
+
+    if (any_changed || !pages || pages->size() != num_pages) {
+        std::shared_ptr<ValueSnapshot::Pages> new_pages{
+            pages ? new ValueSnapshot::Pages{*pages}
+                  : new ValueSnapshot::Pages{}};
+        new_pages->resize(num_pages);
+
+        // pages that didn't change are shared with the last snapshot
+        for (size_t p = 0; p < num_pages; ++p) {
+            if (changed[p] || !(*new_pages)[p]) {
+                auto begin = values.begin() + p * page_size;
+                auto end = values.begin() +
+                           std::min(values.size(), (p + 1) * page_size);
+                (*new_pages)[p].reset(new ValueSnapshot::Page{begin, end});
+                changed[p] = false;
+            }
+        }
+
+        pages = std::move(new_pages);
+        any_changed = false;
+    }
+
+    ValueSnapshot result{};
+    result.pages = pages;
+    result.variables = variables;
+    result.num_values = values.size();
+    return result;
+}
+
+void ValueStore::restore(const ValueSnapshot& snapshot) {
+    if (snapshot.empty()) {
+        return;
+    }
+
+    // with the same layout, the pages of the snapshot are copied straight
+    // into the store and shared again by the next snapshot
+    if (snapshot.variables == variables) {
+        for (size_t p = 0; p < snapshot.pages->size(); ++p) {
+            const auto& page = *(*snapshot.pages)[p];
+            std::memcpy(&values[p * page_size],
+                        page.data(),
+                        page.size() * sizeof(double));
+        }
+        scatter();
+
+        pages = snapshot.pages;
+        std::fill(changed.begin(), changed.end(), false);
+        any_changed = false;
+        return;
+    }
+
+    for (size_t p = 0; p < snapshot.pages->size(); ++p) {
+        const auto& page = *(*snapshot.pages)[p];
+        for (size_t i = 0; i < page.size(); ++i) {
+            auto var = (*snapshot.variables)[p * page_size + i];
+            var->value = page[i];
+            if (contains(var)) {
+                values[var->slot] = page[i];
+                mark_changed(var->slot);
+            }
+        }
+    }
+}
+
+void ValueStore::scatter() const {
+    for (size_t i = 0; i < values.size(); ++i) {
+        (*variables)[i]->value = values[i];
+    }
+}
+
+void ValueStore::save(std::vector<double>& out) const {
+    out.resize(values.size());
+    if (!values.empty()) {
+        std::memcpy(out.data(), values.data(), values.size() * sizeof(double));
+    }
+}
+
+void ValueStore::load(const std::vector<double>& in) {
+    assert(in.size() == values.size() &&
+           "The values should have been saved from this store");
+    if (!values.empty()) {
+        std::memcpy(values.data(), in.data(), values.size() * sizeof(double));
+    }
+    std::fill(changed.begin(), changed.end(), true);
+    any_changed = true;
+}
+
+}  // namespace gcs
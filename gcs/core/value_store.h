@@ -0,0 +1,156 @@
+#ifndef GCS_CORE_VALUE_STORE
+#define GCS_CORE_VALUE_STORE
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "gcs/core/solve_elements.h"
+
+namespace gcs {
+
+//! The values of a value store at one point in time
+//!
+//! Values are kept in fixed size pages, which are shared between snapshots
+//! for as long as they don't change. Taking a snapshot when nothing changed
+//! since the last one is O(1), and otherwise only the pages that changed are
+//! copied, so an undo stack of snapshots only grows by the pages that changed
+//! between them.
+//!
+//! @see ValueStore::snapshot
+class ValueSnapshot {
+   public:
+    //! A copy of consecutive values
+    using Page = std::vector<double>;
+    using Pages = std::vector<std::shared_ptr<const Page>>;
+
+    //! @returns the number of values in the snapshot
+    size_t size() const { return num_values; }
+    //! @returns true if the snapshot doesn't hold any values
+    bool empty() const { return num_values == 0; }
+    //! @returns the number of pages the values are kept in
+    size_t num_pages() const { return pages ? pages->size() : 0; }
+    //! @returns the number of pages that are shared with another snapshot
+    size_t num_shared_pages(const ValueSnapshot& other) const;
+
+   private:
+    friend class ValueStore;
+
+    std::shared_ptr<const Pages> pages;
+    //! The variable that owns each value
+    std::shared_ptr<const std::vector<Variable*>> variables;
+    size_t num_values = 0;
+};
+
+//! The values of the variables of a problem, stored in one contiguous array
+//!
+//! Each variable that is added is given a slot, which it keeps until the store
+//! is cleared. While a problem is solved, the store holds the current values:
+//! they're gathered from the variables before solving, the ceres parameter
+//! blocks and closed form solutions point into the store, and the results are
+//! scattered back to the variables afterwards. Variables are added one
+//! equation set at a time, so the values that an equation set solves for are
+//! next to each other.
+//!
+//! Variables still own their values outside of a solve, since they're members
+//! of the geometry that uses them.
+class ValueStore {
+   public:
+    //! Type used for slots
+    using Slot = uint32_t;
+
+    //! Marks a value that isn't in the store
+    static constexpr Slot none = ~Slot{0};
+    //! Number of values in each page of a snapshot
+    static constexpr Slot page_size = 512;
+
+    ValueStore();
+
+    //! Adds a variable, unless it already has a slot in this store
+    //!
+    //! The value of the variable is copied into its slot. Adding a variable
+    //! may move the values, which invalidates any pointer returned by find.
+    //!
+    //! @returns the slot of the variable
+    Slot add(Variable* var);
+
+    //! Removes all variables
+    void clear();
+
+    //! @returns the number of slots
+    Slot size() const { return values.size(); }
+
+    //! @returns true if a variable has a slot in this store
+    bool contains(const Variable* var) const {
+        return var->slot < variables->size() && (*variables)[var->slot] == var;
+    }
+
+    //! @returns the slot of a variable's value, or none if the value isn't in
+    //! this store
+    Slot slot(const double* value) const;
+
+    //! @returns the location of a variable's value in this store, or null if
+    //! the value isn't in this store
+    double* find(const double* value);
+
+    //! @returns the values, indexed by slot
+    double* data() { return values.data(); }
+    const double* data() const { return values.data(); }
+
+    //! @returns the variable that owns a slot
+    Variable* variable(Slot slot) const { return (*variables)[slot]; }
+
+    //! Copies the value of every variable into its slot
+    void gather();
+
+    //! Records that the value in a slot was written through a pointer (such
+    //! as by ceres), so the next snapshot doesn't share its old page
+    void mark_changed(Slot slot) {
+        changed[slot / page_size] = true;
+        any_changed = true;
+    }
+
+    //! Takes a snapshot of the values in the store
+    //!
+    //! @see ValueSnapshot
+    ValueSnapshot snapshot();
+
+    //! Sets every variable of a snapshot back to its value in the snapshot,
+    //! along with its slot in this store
+    //!
+    //! The snapshot can be from before the variables were laid out again, but
+    //! all of its variables must still exist.
+    void restore(const ValueSnapshot& snapshot);
+
+    //! Copies the value in every slot back to its variable
+    void scatter() const;
+
+    //! Copies all values out of the store at once
+    //!
+    //! @param out the values, indexed by slot
+    void save(std::vector<double>& out) const;
+
+    //! Copies all values into the store at once
+    //!
+    //! @param in values that were saved from this store, indexed by slot
+    void load(const std::vector<double>& in);
+
+   private:
+    std::vector<double> values;
+    //! The variable that owns each slot, which is shared with the snapshots
+    //! and copied before it's changed
+    std::shared_ptr<std::vector<Variable*>> variables;
+    //! Slot of each variable, by the address of its value
+    std::unordered_map<const double*, Slot> slots;
+
+    //! The pages of the last snapshot
+    std::shared_ptr<const ValueSnapshot::Pages> pages;
+    //! Whether each page changed since the last snapshot
+    std::vector<bool> changed;
+    bool any_changed = false;
+};
+
+}  // namespace gcs
+
+#endif  // GCS_CORE_VALUE_STORE
@@ -3,6 +3,7 @@
 
 #include <ceres/ceres.h>
 
+#include <cmath>
 #include <metal.hpp>
 #include <vector>
 
@@ -41,9 +42,93 @@ struct PointOnLine : gcs::Constraint {
             return true;
         }
     };
+    struct CostFunction_0 : ceres::SizedCostFunction<1, 1, 1, 1, 1, 1, 1> {
+        bool Evaluate(double const* const* parameters,
+                      double* residuals,
+                      double** jacobians) const {
+            const double point_x = parameters[0][0];
+            const double point_y = parameters[1][0];
+            const double line_p1_x = parameters[2][0];
+            const double line_p1_y = parameters[3][0];
+            const double line_p2_x = parameters[4][0];
+            const double line_p2_y = parameters[5][0];
+
+            residuals[0] = point_on_line(point_x,
+                                         point_y,
+                                         line_p1_x,
+                                         line_p1_y,
+                                         line_p2_x,
+                                         line_p2_y);
+            if (!jacobians) {
+                return true;
+            }
+
+            if (jacobians[0]) {
+                jacobians[0][0] = line_p1_y - line_p2_y;
+            }
+            if (jacobians[1]) {
+                jacobians[1][0] = -line_p1_x + line_p2_x;
+            }
+            if (jacobians[2]) {
+                jacobians[2][0] = line_p2_y - point_y;
+            }
+            if (jacobians[3]) {
+                jacobians[3][0] = -line_p2_x + point_x;
+            }
+            if (jacobians[4]) {
+                jacobians[4][0] = -line_p1_y + point_y;
+            }
+            if (jacobians[5]) {
+                jacobians[5][0] = line_p1_x - point_x;
+            }
+            return true;
+        }
+
+        static void evaluate_batch(size_t count,
+                                   const double* arguments,
+                                   double* residuals,
+                                   double* jacobians) {
+#pragma omp simd
+            for (size_t i = 0; i < count; ++i) {
+                const double point_x = arguments[i];
+                const double point_y = arguments[count + i];
+                const double line_p1_x = arguments[2 * count + i];
+                const double line_p1_y = arguments[3 * count + i];
+                const double line_p2_x = arguments[4 * count + i];
+                const double line_p2_y = arguments[5 * count + i];
+
+                residuals[i] = point_on_line(point_x,
+                                             point_y,
+                                             line_p1_x,
+                                             line_p1_y,
+                                             line_p2_x,
+                                             line_p2_y);
+            }
+            if (!jacobians) {
+                return;
+            }
+
+#pragma omp simd
+            for (size_t i = 0; i < count; ++i) {
+                const double point_x = arguments[i];
+                const double point_y = arguments[count + i];
+                const double line_p1_x = arguments[2 * count + i];
+                const double line_p1_y = arguments[3 * count + i];
+                const double line_p2_x = arguments[4 * count + i];
+                const double line_p2_y = arguments[5 * count + i];
+
+                jacobians[i] = line_p1_y - line_p2_y;
+                jacobians[count + i] = -line_p1_x + line_p2_x;
+                jacobians[2 * count + i] = line_p2_y - point_y;
+                jacobians[3 * count + i] = -line_p2_x + point_x;
+                jacobians[4 * count + i] = -line_p1_y + point_y;
+                jacobians[5 * count + i] = line_p1_x - point_x;
+            }
+        }
+    };
 
     void add_to_problem(ceres::Problem& problem) {
-        problem.AddResidualBlock(gcs::create_scalar_autodiff(new Functor_0{}),
+        problem.AddResidualBlock(new CostFunction_0{},
                                  nullptr,
                                  &point->x.value,
                                  &point->y.value,
@@ -53,30 +138,43 @@ struct PointOnLine : gcs::Constraint {
                                  &line->p2.y.value);
     }
 
-    std::vector<gcs::Equation*> get_equations() const {
+    std::vector<gcs::Equation*> get_equations(gcs::Arena& arena) const {
         std::vector<gcs::Equation*> eqns{};
 
-        eqns.push_back(
-            new Equation{{&point->x,
-                          &point->y,
-                          &line->p1.x,
-                          &line->p1.y,
-                          &line->p2.x,
-                          &line->p2.y},
-                         [&](ceres::Problem& problem) {
-                             problem.AddResidualBlock(
-                                 gcs::create_scalar_autodiff(new Functor_0{}),
-                                 nullptr,
-                                 &point->x.value,
-                                 &point->y.value,
-                                 &line->p1.x.value,
-                                 &line->p1.y.value,
-                                 &line->p2.x.value,
-                                 &line->p2.y.value);
-                         }});
+        eqns.push_back(arena.make_equation(
+            {&point->x,
+             &point->y,
+             &line->p1.x,
+             &line->p1.y,
+             &line->p2.x,
+             &line->p2.y},
+            [&](ceres::Problem& problem) {
+                problem.AddResidualBlock(new CostFunction_0{},
+                                         nullptr,
+                                         &point->x.value,
+                                         &point->y.value,
+                                         &line->p1.x.value,
+                                         &line->p1.y.value,
+                                         &line->p2.x.value,
+                                         &line->p2.y.value);
+            },
+            "point_on_line",
+            {&point->x.value,
+             &point->y.value,
+             &line->p1.x.value,
+             &line->p1.y.value,
+             &line->p2.x.value,
+             &line->p2.y.value},
+            &CostFunction_0::evaluate_batch));
 
         return eqns;
     }
+
+    const char* type_name() const { return "gcs.g2d.PointOnLine"; }
+
+    std::vector<gcs::Constraint::Argument> get_arguments() const {
+        return {{point, nullptr}, {line, nullptr}};
+    }
 };
 
 struct CoincidentPoints : gcs::Constraint {
@@ -104,40 +202,92 @@ struct CoincidentPoints : gcs::Constraint {
             return true;
         }
     };
+    struct CostFunction_0 : ceres::SizedCostFunction<1, 1, 1> {
+        bool Evaluate(double const* const* parameters,
+                      double* residuals,
+                      double** jacobians) const {
+            const double p1_x = parameters[0][0];
+            const double p2_x = parameters[1][0];
+
+            residuals[0] = equate(p1_x, p2_x);
+            if (!jacobians) {
+                return true;
+            }
+
+            if (jacobians[0]) {
+                jacobians[0][0] = 1;
+            }
+            if (jacobians[1]) {
+                jacobians[1][0] = -1;
+            }
+            return true;
+        }
+    };
+    struct CostFunction_1 : ceres::SizedCostFunction<1, 1, 1> {
+        bool Evaluate(double const* const* parameters,
+                      double* residuals,
+                      double** jacobians) const {
+            const double p1_y = parameters[0][0];
+            const double p2_y = parameters[1][0];
+
+            residuals[0] = equate(p1_y, p2_y);
+            if (!jacobians) {
+                return true;
+            }
+
+            if (jacobians[0]) {
+                jacobians[0][0] = 1;
+            }
+            if (jacobians[1]) {
+                jacobians[1][0] = -1;
+            }
+            return true;
+        }
+    };
 
     void add_to_problem(ceres::Problem& problem) {
-        problem.AddResidualBlock(gcs::create_scalar_autodiff(new Functor_0{}),
+        problem.AddResidualBlock(new CostFunction_0{},
                                  nullptr,
                                  &p1->x.value,
                                  &p2->x.value);
-        problem.AddResidualBlock(gcs::create_scalar_autodiff(new Functor_1{}),
+        problem.AddResidualBlock(new CostFunction_1{},
                                  nullptr,
                                  &p1->y.value,
                                  &p2->y.value);
     }
 
-    std::vector<gcs::Equation*> get_equations() const {
+    std::vector<gcs::Equation*> get_equations(gcs::Arena& arena) const {
         std::vector<gcs::Equation*> eqns{};
 
-        eqns.push_back(
-            new Equation{{&p1->x, &p2->x}, [&](ceres::Problem& problem) {
-                             problem.AddResidualBlock(
-                                 gcs::create_scalar_autodiff(new Functor_0{}),
-                                 nullptr,
-                                 &p1->x.value,
-                                 &p2->x.value);
-                         }});
-        eqns.push_back(
-            new Equation{{&p1->y, &p2->y}, [&](ceres::Problem& problem) {
-                             problem.AddResidualBlock(
-                                 gcs::create_scalar_autodiff(new Functor_1{}),
-                                 nullptr,
-                                 &p1->y.value,
-                                 &p2->y.value);
-                         }});
+        eqns.push_back(arena.make_equation(
+            {&p1->x, &p2->x},
+            [&](ceres::Problem& problem) {
+                problem.AddResidualBlock(new CostFunction_0{},
+                                         nullptr,
+                                         &p1->x.value,
+                                         &p2->x.value);
+            },
+            "equate",
+            {&p1->x.value, &p2->x.value}));
+        eqns.push_back(arena.make_equation(
+            {&p1->y, &p2->y},
+            [&](ceres::Problem& problem) {
+                problem.AddResidualBlock(new CostFunction_1{},
+                                         nullptr,
+                                         &p1->y.value,
+                                         &p2->y.value);
+            },
+            "equate",
+            {&p1->y.value, &p2->y.value}));
 
         return eqns;
     }
+
+    const char* type_name() const { return "gcs.g2d.CoincidentPoints"; }
+
+    std::vector<gcs::Constraint::Argument> get_arguments() const {
+        return {{p1, nullptr}, {p2, nullptr}};
+    }
 };
 
 struct DistancePoints : gcs::Constraint {
@@ -162,9 +312,84 @@ struct DistancePoints : gcs::Constraint {
             return true;
         }
     };
+    struct CostFunction_0 : ceres::SizedCostFunction<1, 1, 1, 1, 1, 1> {
+        bool Evaluate(double const* const* parameters,
+                      double* residuals,
+                      double** jacobians) const {
+            const double p1_x = parameters[0][0];
+            const double p1_y = parameters[1][0];
+            const double p2_x = parameters[2][0];
+            const double p2_y = parameters[3][0];
+            const double d = parameters[4][0];
+
+            residuals[0] = distance(p1_x, p1_y, p2_x, p2_y, d);
+            if (!jacobians) {
+                return true;
+            }
+
+            const double t0 = p1_x - p2_x;
+            const double t1 = p1_y - p2_y;
+            const double t2 = 1.0 / std::sqrt(t0 * t0 + t1 * t1);
+
+            if (jacobians[0]) {
+                jacobians[0][0] = t0 * t2;
+            }
+            if (jacobians[1]) {
+                jacobians[1][0] = t1 * t2;
+            }
+            if (jacobians[2]) {
+                jacobians[2][0] = -t0 * t2;
+            }
+            if (jacobians[3]) {
+                jacobians[3][0] = -t1 * t2;
+            }
+            if (jacobians[4]) {
+                jacobians[4][0] = -(d < 0 ? -1 : 1);
+            }
+            return true;
+        }
+
+        static void evaluate_batch(size_t count,
+                                   const double* arguments,
+                                   double* residuals,
+                                   double* jacobians) {
+#pragma omp simd
+            for (size_t i = 0; i < count; ++i) {
+                const double p1_x = arguments[i];
+                const double p1_y = arguments[count + i];
+                const double p2_x = arguments[2 * count + i];
+                const double p2_y = arguments[3 * count + i];
+                const double d = arguments[4 * count + i];
+
+                residuals[i] = distance(p1_x, p1_y, p2_x, p2_y, d);
+            }
+            if (!jacobians) {
+                return;
+            }
+
+#pragma omp simd
+            for (size_t i = 0; i < count; ++i) {
+                const double p1_x = arguments[i];
+                const double p1_y = arguments[count + i];
+                const double p2_x = arguments[2 * count + i];
+                const double p2_y = arguments[3 * count + i];
+                const double d = arguments[4 * count + i];
+
+                const double t0 = p1_x - p2_x;
+                const double t1 = p1_y - p2_y;
+                const double t2 = 1.0 / std::sqrt(t0 * t0 + t1 * t1);
+
+                jacobians[i] = t0 * t2;
+                jacobians[count + i] = t1 * t2;
+                jacobians[2 * count + i] = -t0 * t2;
+                jacobians[3 * count + i] = -t1 * t2;
+                jacobians[4 * count + i] = -(d < 0 ? -1 : 1);
+            }
+        }
+    };
 
     void add_to_problem(ceres::Problem& problem) {
-        problem.AddResidualBlock(gcs::create_scalar_autodiff(new Functor_0{}),
+        problem.AddResidualBlock(new CostFunction_0{},
                                  nullptr,
                                  &p1->x.value,
                                  &p1->y.value,
@@ -173,23 +398,36 @@ struct DistancePoints : gcs::Constraint {
                                  &d->value);
     }
 
-    std::vector<gcs::Equation*> get_equations() const {
+    std::vector<gcs::Equation*> get_equations(gcs::Arena& arena) const {
         std::vector<gcs::Equation*> eqns{};
 
-        eqns.push_back(new Equation{
-            {&p1->x, &p1->y, &p2->x, &p2->y, d}, [&](ceres::Problem& problem) {
-                problem.AddResidualBlock(
-                    gcs::create_scalar_autodiff(new Functor_0{}),
-                    nullptr,
-                    &p1->x.value,
-                    &p1->y.value,
-                    &p2->x.value,
-                    &p2->y.value,
-                    &d->value);
-            }});
+        eqns.push_back(arena.make_equation(
+            {&p1->x, &p1->y, &p2->x, &p2->y, d},
+            [&](ceres::Problem& problem) {
+                problem.AddResidualBlock(new CostFunction_0{},
+                                         nullptr,
+                                         &p1->x.value,
+                                         &p1->y.value,
+                                         &p2->x.value,
+                                         &p2->y.value,
+                                         &d->value);
+            },
+            "distance",
+            {&p1->x.value,
+             &p1->y.value,
+             &p2->x.value,
+             &p2->y.value,
+             &d->value},
+            &CostFunction_0::evaluate_batch));
 
         return eqns;
     }
+
+    const char* type_name() const { return "gcs.g2d.DistancePoints"; }
+
+    std::vector<gcs::Constraint::Argument> get_arguments() const {
+        return {{p1, nullptr}, {p2, nullptr}, {nullptr, d}};
+    }
 };
 
 struct LineLength : gcs::Constraint {
@@ -212,9 +450,50 @@ struct LineLength : gcs::Constraint {
             return true;
         }
     };
+    struct CostFunction_0 : ceres::SizedCostFunction<1, 1, 1, 1, 1, 1> {
+        bool Evaluate(double const* const* parameters,
+                      double* residuals,
+                      double** jacobians) const {
+            const double line_p1_x = parameters[0][0];
+            const double line_p1_y = parameters[1][0];
+            const double line_p2_x = parameters[2][0];
+            const double line_p2_y = parameters[3][0];
+            const double d = parameters[4][0];
+
+            residuals[0] = distance(line_p1_x,
+                                    line_p1_y,
+                                    line_p2_x,
+                                    line_p2_y,
+                                    d);
+            if (!jacobians) {
+                return true;
+            }
+
+            const double t0 = line_p1_x - line_p2_x;
+            const double t1 = line_p1_y - line_p2_y;
+            const double t2 = 1.0 / std::sqrt(t0 * t0 + t1 * t1);
+
+            if (jacobians[0]) {
+                jacobians[0][0] = t0 * t2;
+            }
+            if (jacobians[1]) {
+                jacobians[1][0] = t1 * t2;
+            }
+            if (jacobians[2]) {
+                jacobians[2][0] = -t0 * t2;
+            }
+            if (jacobians[3]) {
+                jacobians[3][0] = -t1 * t2;
+            }
+            if (jacobians[4]) {
+                jacobians[4][0] = -(d < 0 ? -1 : 1);
+            }
+            return true;
+        }
+    };
 
     void add_to_problem(ceres::Problem& problem) {
-        problem.AddResidualBlock(gcs::create_scalar_autodiff(new Functor_0{}),
+        problem.AddResidualBlock(new CostFunction_0{},
                                  nullptr,
                                  &line->p1.x.value,
                                  &line->p1.y.value,
@@ -223,24 +502,35 @@ struct LineLength : gcs::Constraint {
                                  &d->value);
     }
 
-    std::vector<gcs::Equation*> get_equations() const {
+    std::vector<gcs::Equation*> get_equations(gcs::Arena& arena) const {
         std::vector<gcs::Equation*> eqns{};
 
-        eqns.push_back(new Equation{
+        eqns.push_back(arena.make_equation(
             {&line->p1.x, &line->p1.y, &line->p2.x, &line->p2.y, d},
             [&](ceres::Problem& problem) {
-                problem.AddResidualBlock(
-                    gcs::create_scalar_autodiff(new Functor_0{}),
-                    nullptr,
-                    &line->p1.x.value,
-                    &line->p1.y.value,
-                    &line->p2.x.value,
-                    &line->p2.y.value,
-                    &d->value);
-            }});
+                problem.AddResidualBlock(new CostFunction_0{},
+                                         nullptr,
+                                         &line->p1.x.value,
+                                         &line->p1.y.value,
+                                         &line->p2.x.value,
+                                         &line->p2.y.value,
+                                         &d->value);
+            },
+            "distance",
+            {&line->p1.x.value,
+             &line->p1.y.value,
+             &line->p2.x.value,
+             &line->p2.y.value,
+             &d->value}));
 
         return eqns;
     }
+
+    const char* type_name() const { return "gcs.g2d.LineLength"; }
+
+    std::vector<gcs::Constraint::Argument> get_arguments() const {
+        return {{line, nullptr}, {nullptr, d}};
+    }
 };
 
 struct OffsetLinePoint : gcs::Constraint {
@@ -275,9 +565,88 @@ struct OffsetLinePoint : gcs::Constraint {
             return true;
         }
     };
+    struct CostFunction_0 : ceres::SizedCostFunction<1, 1, 1, 1, 1, 1, 1, 1> {
+        bool Evaluate(double const* const* parameters,
+                      double* residuals,
+                      double** jacobians) const {
+            const double line_p1_x = parameters[0][0];
+            const double line_p1_y = parameters[1][0];
+            const double line_p2_x = parameters[2][0];
+            const double line_p2_y = parameters[3][0];
+            const double point_x = parameters[4][0];
+            const double point_y = parameters[5][0];
+            const double d = parameters[6][0];
+
+            residuals[0] = offset_line_point(line_p1_x,
+                                             line_p1_y,
+                                             line_p2_x,
+                                             line_p2_y,
+                                             point_x,
+                                             point_y,
+                                             d);
+            if (!jacobians) {
+                return true;
+            }
+
+            const double t0 = line_p1_x - line_p2_x;
+            const double t1 = -line_p1_y + point_y;
+            const double t2 = t0 * t0;
+            const double t3 = line_p1_y - line_p2_y;
+            const double t4 = t3 * t3;
+            const double t5 = std::sqrt(t2 + t4);
+            const double t6 = 1.0 / t5;
+            const double t7 = t0 * t6;
+            const double t8 = -line_p1_x + point_x;
+            const double t9 = -t3 * (-t5 + t7 * t8);
+            const double t10 = -d * t0;
+            const double t11 = t1 * t5;
+            const double t12 = t10 - t11;
+            const double t13 = -d * t3;
+            const double t14 = t5 * t8;
+            const double t15 = t13 + t14;
+            const double t16 = t10 + t11;
+            const double t17 = t13 - t14;
+            const bool t18 = t0 * t12 + t15 * t3 < -t0 * t16 - t17 * t3;
+            const double t19 = t3 * t6;
+            const double t20 = t1 * t19 - t5;
+            const double t21 = -t0 * t6;
+            const double t22 = -t3 * t8;
+            const double t23 = t21 * t22;
+            const double t24 = t1 * t21;
+
+            if (jacobians[0]) {
+                jacobians[0][0] = t18 ? -t0 * (d + t1 * t7) + t12 - t9
+                                      : -t0 * (-d + t0 * t1 * t6) - t16 - t9;
+            }
+            if (jacobians[1]) {
+                jacobians[1][0] =
+                    t18 ? -t0 * t20 + t15 + t3 * (-d + t3 * t6 * t8)
+                        : -t0 * t20 - t17 + t3 * (d + t19 * t8);
+            }
+            if (jacobians[2]) {
+                jacobians[2][0] = t18 ? -t0 * (-d - t0 * t1 * t6) - t12 - t23
+                                      : -t0 * (d + t24) + t16 - t23;
+            }
+            if (jacobians[3]) {
+                jacobians[3][0] =
+                    t18 ? t0 * t1 * t3 * t6 - t15 + t3 * (d + t22 * t6)
+                        : t17 - t24 * t3 + t3 * (-d - t3 * t6 * t8);
+            }
+            if (jacobians[4]) {
+                jacobians[4][0] = t3 * t5;
+            }
+            if (jacobians[5]) {
+                jacobians[5][0] = -t0 * t5;
+            }
+            if (jacobians[6]) {
+                jacobians[6][0] = t18 ? -t0 * t0 - t4 : t2 + t3 * t3;
+            }
+            return true;
+        }
+    };
 
     void add_to_problem(ceres::Problem& problem) {
-        problem.AddResidualBlock(gcs::create_scalar_autodiff(new Functor_0{}),
+        problem.AddResidualBlock(new CostFunction_0{},
                                  nullptr,
                                  &line->p1.x.value,
                                  &line->p1.y.value,
@@ -288,32 +657,45 @@ struct OffsetLinePoint : gcs::Constraint {
                                  &d->value);
     }
 
-    std::vector<gcs::Equation*> get_equations() const {
+    std::vector<gcs::Equation*> get_equations(gcs::Arena& arena) const {
         std::vector<gcs::Equation*> eqns{};
 
-        eqns.push_back(
-            new Equation{{&line->p1.x,
-                          &line->p1.y,
-                          &line->p2.x,
-                          &line->p2.y,
-                          &point->x,
-                          &point->y,
-                          d},
-                         [&](ceres::Problem& problem) {
-                             problem.AddResidualBlock(
-                                 gcs::create_scalar_autodiff(new Functor_0{}),
-                                 nullptr,
-                                 &line->p1.x.value,
-                                 &line->p1.y.value,
-                                 &line->p2.x.value,
-                                 &line->p2.y.value,
-                                 &point->x.value,
-                                 &point->y.value,
-                                 &d->value);
-                         }});
+        eqns.push_back(arena.make_equation(
+            {&line->p1.x,
+             &line->p1.y,
+             &line->p2.x,
+             &line->p2.y,
+             &point->x,
+             &point->y,
+             d},
+            [&](ceres::Problem& problem) {
+                problem.AddResidualBlock(new CostFunction_0{},
+                                         nullptr,
+                                         &line->p1.x.value,
+                                         &line->p1.y.value,
+                                         &line->p2.x.value,
+                                         &line->p2.y.value,
+                                         &point->x.value,
+                                         &point->y.value,
+                                         &d->value);
+            },
+            "offset_line_point",
+            {&line->p1.x.value,
+             &line->p1.y.value,
+             &line->p2.x.value,
+             &line->p2.y.value,
+             &point->x.value,
+             &point->y.value,
+             &d->value}));
 
         return eqns;
     }
+
+    const char* type_name() const { return "gcs.g2d.OffsetLinePoint"; }
+
+    std::vector<gcs::Constraint::Argument> get_arguments() const {
+        return {{line, nullptr}, {point, nullptr}, {nullptr, d}};
+    }
 };
 
 struct AngleBetweenLines : gcs::Constraint {
@@ -352,9 +734,80 @@ struct AngleBetweenLines : gcs::Constraint {
             return true;
         }
     };
+    struct CostFunction_0
+        : ceres::SizedCostFunction<1, 1, 1, 1, 1, 1, 1, 1, 1, 1> {
+        bool Evaluate(double const* const* parameters,
+                      double* residuals,
+                      double** jacobians) const {
+            const double line1_p1_x = parameters[0][0];
+            const double line1_p1_y = parameters[1][0];
+            const double line1_p2_x = parameters[2][0];
+            const double line1_p2_y = parameters[3][0];
+            const double line2_p1_x = parameters[4][0];
+            const double line2_p1_y = parameters[5][0];
+            const double line2_p2_x = parameters[6][0];
+            const double line2_p2_y = parameters[7][0];
+            const double angle = parameters[8][0];
+
+            residuals[0] = angle_point_4(line1_p1_x,
+                                         line1_p1_y,
+                                         line1_p2_x,
+                                         line1_p2_y,
+                                         line2_p1_x,
+                                         line2_p1_y,
+                                         line2_p2_x,
+                                         line2_p2_y,
+                                         angle);
+            if (!jacobians) {
+                return true;
+            }
+
+            const double t0 = -line1_p1_y + line1_p2_y;
+            const double t1 = line1_p1_x - line1_p2_x;
+            const double t2 = 1.0 / (t0 * t0 + t1 * t1);
+            const double t3 = t0 * t2;
+            const double t4 = line2_p1_x - line2_p2_x;
+            const double t5 = -line2_p1_y + line2_p2_y;
+            const bool t6 =
+                -std::atan2(0.0 - t1, t0) + std::atan2(0.0 - t4, t5) < 0;
+            const double t7 = t1 * t2;
+            const double t8 = 1.0 / (t4 * t4 + t5 * t5);
+            const double t9 = t5 * t8;
+            const double t10 = t4 * t8;
+
+            if (jacobians[0]) {
+                jacobians[0][0] = t6 ? -t3 : t3;
+            }
+            if (jacobians[1]) {
+                jacobians[1][0] = t6 ? -t7 : t7;
+            }
+            if (jacobians[2]) {
+                jacobians[2][0] = t6 ? t3 : -t3;
+            }
+            if (jacobians[3]) {
+                jacobians[3][0] = t6 ? t7 : -t7;
+            }
+            if (jacobians[4]) {
+                jacobians[4][0] = t6 ? t9 : -t9;
+            }
+            if (jacobians[5]) {
+                jacobians[5][0] = t6 ? t10 : -t10;
+            }
+            if (jacobians[6]) {
+                jacobians[6][0] = t6 ? -t9 : t9;
+            }
+            if (jacobians[7]) {
+                jacobians[7][0] = t6 ? -t10 : t10;
+            }
+            if (jacobians[8]) {
+                jacobians[8][0] = -1;
+            }
+            return true;
+        }
+    };
 
     void add_to_problem(ceres::Problem& problem) {
-        problem.AddResidualBlock(gcs::create_scalar_autodiff(new Functor_0{}),
+        problem.AddResidualBlock(new CostFunction_0{},
                                  nullptr,
                                  &line1->p1.x.value,
                                  &line1->p1.y.value,
@@ -367,36 +820,51 @@ struct AngleBetweenLines : gcs::Constraint {
                                  &angle->value);
     }
 
-    std::vector<gcs::Equation*> get_equations() const {
+    std::vector<gcs::Equation*> get_equations(gcs::Arena& arena) const {
         std::vector<gcs::Equation*> eqns{};
 
-        eqns.push_back(
-            new Equation{{&line1->p1.x,
-                          &line1->p1.y,
-                          &line1->p2.x,
-                          &line1->p2.y,
-                          &line2->p1.x,
-                          &line2->p1.y,
-                          &line2->p2.x,
-                          &line2->p2.y,
-                          angle},
-                         [&](ceres::Problem& problem) {
-                             problem.AddResidualBlock(
-                                 gcs::create_scalar_autodiff(new Functor_0{}),
-                                 nullptr,
-                                 &line1->p1.x.value,
-                                 &line1->p1.y.value,
-                                 &line1->p2.x.value,
-                                 &line1->p2.y.value,
-                                 &line2->p1.x.value,
-                                 &line2->p1.y.value,
-                                 &line2->p2.x.value,
-                                 &line2->p2.y.value,
-                                 &angle->value);
-                         }});
+        eqns.push_back(arena.make_equation(
+            {&line1->p1.x,
+             &line1->p1.y,
+             &line1->p2.x,
+             &line1->p2.y,
+             &line2->p1.x,
+             &line2->p1.y,
+             &line2->p2.x,
+             &line2->p2.y,
+             angle},
+            [&](ceres::Problem& problem) {
+                problem.AddResidualBlock(new CostFunction_0{},
+                                         nullptr,
+                                         &line1->p1.x.value,
+                                         &line1->p1.y.value,
+                                         &line1->p2.x.value,
+                                         &line1->p2.y.value,
+                                         &line2->p1.x.value,
+                                         &line2->p1.y.value,
+                                         &line2->p2.x.value,
+                                         &line2->p2.y.value,
+                                         &angle->value);
+            },
+            "angle_point_4",
+            {&line1->p1.x.value,
+             &line1->p1.y.value,
+             &line1->p2.x.value,
+             &line1->p2.y.value,
+             &line2->p1.x.value,
+             &line2->p1.y.value,
+             &line2->p2.x.value,
+             &line2->p2.y.value,
+             &angle->value}));
 
         return eqns;
     }
+
+    const char* type_name() const { return "gcs.g2d.AngleBetweenLines"; }
+
+    std::vector<gcs::Constraint::Argument> get_arguments() const {
+        return {{line1, nullptr}, {line2, nullptr}, {nullptr, angle}};
+    }
 };
 
 struct AngleThreePoints : gcs::Constraint {
@@ -428,9 +896,70 @@ struct AngleThreePoints : gcs::Constraint {
             return true;
         }
     };
+    struct CostFunction_0 : ceres::SizedCostFunction<1, 1, 1, 1, 1, 1, 1, 1> {
+        bool Evaluate(double const* const* parameters,
+                      double* residuals,
+                      double** jacobians) const {
+            const double p1_x = parameters[0][0];
+            const double p1_y = parameters[1][0];
+            const double p2_x = parameters[2][0];
+            const double p2_y = parameters[3][0];
+            const double p3_x = parameters[4][0];
+            const double p3_y = parameters[5][0];
+            const double angle = parameters[6][0];
+
+            residuals[0] = angle_point_3(p1_x,
+                                         p1_y,
+                                         p2_x,
+                                         p2_y,
+                                         p3_x,
+                                         p3_y,
+                                         angle);
+            if (!jacobians) {
+                return true;
+            }
+
+            const double t0 = p1_y - p2_y;
+            const double t1 = p1_x - p2_x;
+            const double t2 = 1.0 / (t0 * t0 + t1 * t1);
+            const double t3 = t0 * t2;
+            const double t4 = p2_x - p3_x;
+            const double t5 = -p2_y + p3_y;
+            const bool t6 = -std::atan2(t1, t0) + std::atan2(0.0 - t4, t5) < 0;
+            const double t7 = -t1 * t2;
+            const double t8 = 1.0 / (t4 * t4 + t5 * t5);
+            const double t9 = t5 * t8;
+            const double t10 = t3 - t9;
+            const double t11 = t4 * t8;
+            const double t12 = -t11 + t7;
+
+            if (jacobians[0]) {
+                jacobians[0][0] = t6 ? t3 : -t3;
+            }
+            if (jacobians[1]) {
+                jacobians[1][0] = t6 ? t7 : -t7;
+            }
+            if (jacobians[2]) {
+                jacobians[2][0] = t6 ? -t10 : t10;
+            }
+            if (jacobians[3]) {
+                jacobians[3][0] = t6 ? -t12 : t12;
+            }
+            if (jacobians[4]) {
+                jacobians[4][0] = t6 ? -t9 : t9;
+            }
+            if (jacobians[5]) {
+                jacobians[5][0] = t6 ? -t11 : t11;
+            }
+            if (jacobians[6]) {
+                jacobians[6][0] = -1;
+            }
+            return true;
+        }
+    };
 
     void add_to_problem(ceres::Problem& problem) {
-        problem.AddResidualBlock(gcs::create_scalar_autodiff(new Functor_0{}),
+        problem.AddResidualBlock(new CostFunction_0{},
                                  nullptr,
                                  &p1->x.value,
                                  &p1->y.value,
@@ -441,26 +970,39 @@ struct AngleThreePoints : gcs::Constraint {
                                  &angle->value);
     }
 
-    std::vector<gcs::Equation*> get_equations() const {
+    std::vector<gcs::Equation*> get_equations(gcs::Arena& arena) const {
         std::vector<gcs::Equation*> eqns{};
 
-        eqns.push_back(new Equation{
+        eqns.push_back(arena.make_equation(
             {&p1->x, &p1->y, &p2->x, &p2->y, &p3->x, &p3->y, angle},
             [&](ceres::Problem& problem) {
-                problem.AddResidualBlock(
-                    gcs::create_scalar_autodiff(new Functor_0{}),
-                    nullptr,
-                    &p1->x.value,
-                    &p1->y.value,
-                    &p2->x.value,
-                    &p2->y.value,
-                    &p3->x.value,
-                    &p3->y.value,
-                    &angle->value);
-            }});
+                problem.AddResidualBlock(new CostFunction_0{},
+                                         nullptr,
+                                         &p1->x.value,
+                                         &p1->y.value,
+                                         &p2->x.value,
+                                         &p2->y.value,
+                                         &p3->x.value,
+                                         &p3->y.value,
+                                         &angle->value);
+            },
+            "angle_point_3",
+            {&p1->x.value,
+             &p1->y.value,
+             &p2->x.value,
+             &p2->y.value,
+             &p3->x.value,
+             &p3->y.value,
+             &angle->value}));
 
         return eqns;
     }
+
+    const char* type_name() const { return "gcs.g2d.AngleThreePoints"; }
+
+    std::vector<gcs::Constraint::Argument> get_arguments() const {
+        return {{p1, nullptr}, {p2, nullptr}, {p3, nullptr}, {nullptr, angle}};
+    }
 };
 
 struct AngleOfLine : gcs::Constraint {
@@ -485,9 +1027,53 @@ struct AngleOfLine : gcs::Constraint {
             return true;
         }
     };
+    struct CostFunction_0 : ceres::SizedCostFunction<1, 1, 1, 1, 1, 1> {
+        bool Evaluate(double const* const* parameters,
+                      double* residuals,
+                      double** jacobians) const {
+            const double line_p1_x = parameters[0][0];
+            const double line_p1_y = parameters[1][0];
+            const double line_p2_x = parameters[2][0];
+            const double line_p2_y = parameters[3][0];
+            const double angle = parameters[4][0];
+
+            residuals[0] = angle_point_2(line_p1_x,
+                                         line_p1_y,
+                                         line_p2_x,
+                                         line_p2_y,
+                                         angle);
+            if (!jacobians) {
+                return true;
+            }
+
+            const double t0 = line_p1_y - line_p2_y;
+            const double t1 = line_p1_x - line_p2_x;
+            const double t2 = 1.0 / (t0 * t0 + t1 * t1);
+            const double t3 = t0 * t2;
+            const bool t4 = std::atan2(t1, t0) < 0;
+            const double t5 = -t1 * t2;
+
+            if (jacobians[0]) {
+                jacobians[0][0] = t4 ? -t3 : t3;
+            }
+            if (jacobians[1]) {
+                jacobians[1][0] = t4 ? -t5 : t5;
+            }
+            if (jacobians[2]) {
+                jacobians[2][0] = t4 ? t3 : -t3;
+            }
+            if (jacobians[3]) {
+                jacobians[3][0] = t4 ? t5 : -t5;
+            }
+            if (jacobians[4]) {
+                jacobians[4][0] = -1;
+            }
+            return true;
+        }
+    };
 
     void add_to_problem(ceres::Problem& problem) {
-        problem.AddResidualBlock(gcs::create_scalar_autodiff(new Functor_0{}),
+        problem.AddResidualBlock(new CostFunction_0{},
                                  nullptr,
                                  &line->p1.x.value,
                                  &line->p1.y.value,
@@ -496,24 +1082,35 @@ struct AngleOfLine : gcs::Constraint {
                                  &angle->value);
     }
 
-    std::vector<gcs::Equation*> get_equations() const {
+    std::vector<gcs::Equation*> get_equations(gcs::Arena& arena) const {
         std::vector<gcs::Equation*> eqns{};
 
-        eqns.push_back(new Equation{
+        eqns.push_back(arena.make_equation(
             {&line->p1.x, &line->p1.y, &line->p2.x, &line->p2.y, angle},
             [&](ceres::Problem& problem) {
-                problem.AddResidualBlock(
-                    gcs::create_scalar_autodiff(new Functor_0{}),
-                    nullptr,
-                    &line->p1.x.value,
-                    &line->p1.y.value,
-                    &line->p2.x.value,
-                    &line->p2.y.value,
-                    &angle->value);
-            }});
+                problem.AddResidualBlock(new CostFunction_0{},
+                                         nullptr,
+                                         &line->p1.x.value,
+                                         &line->p1.y.value,
+                                         &line->p2.x.value,
+                                         &line->p2.y.value,
+                                         &angle->value);
+            },
+            "angle_point_2",
+            {&line->p1.x.value,
+             &line->p1.y.value,
+             &line->p2.x.value,
+             &line->p2.y.value,
+             &angle->value}));
 
         return eqns;
     }
+
+    const char* type_name() const { return "gcs.g2d.AngleOfLine"; }
+
+    std::vector<gcs::Constraint::Argument> get_arguments() const {
+        return {{line, nullptr}, {nullptr, angle}};
+    }
 };
 
 struct PointOnCircle : gcs::Constraint {
@@ -541,9 +1138,92 @@ struct PointOnCircle : gcs::Constraint {
             return true;
         }
     };
+    struct CostFunction_0 : ceres::SizedCostFunction<1, 1, 1, 1, 1, 1> {
+        bool Evaluate(double const* const* parameters,
+                      double* residuals,
+                      double** jacobians) const {
+            const double point_x = parameters[0][0];
+            const double point_y = parameters[1][0];
+            const double circle_center_x = parameters[2][0];
+            const double circle_center_y = parameters[3][0];
+            const double circle_radius = parameters[4][0];
+
+            residuals[0] = point_on_circle(point_x,
+                                           point_y,
+                                           circle_center_x,
+                                           circle_center_y,
+                                           circle_radius);
+            if (!jacobians) {
+                return true;
+            }
+
+            const double t0 = circle_center_x - point_x;
+            const double t1 = circle_center_y - point_y;
+            const double t2 = 1.0 / std::sqrt(t0 * t0 + t1 * t1);
+
+            if (jacobians[0]) {
+                jacobians[0][0] = -t0 * t2;
+            }
+            if (jacobians[1]) {
+                jacobians[1][0] = -t1 * t2;
+            }
+            if (jacobians[2]) {
+                jacobians[2][0] = t0 * t2;
+            }
+            if (jacobians[3]) {
+                jacobians[3][0] = t1 * t2;
+            }
+            if (jacobians[4]) {
+                jacobians[4][0] = -(circle_radius < 0 ? -1 : 1);
+            }
+            return true;
+        }
+
+        static void evaluate_batch(size_t count,
+                                   const double* arguments,
+                                   double* residuals,
+                                   double* jacobians) {
+#pragma omp simd
+            for (size_t i = 0; i < count; ++i) {
+                const double point_x = arguments[i];
+                const double point_y = arguments[count + i];
+                const double circle_center_x = arguments[2 * count + i];
+                const double circle_center_y = arguments[3 * count + i];
+                const double circle_radius = arguments[4 * count + i];
+
+                residuals[i] = point_on_circle(point_x,
+                                               point_y,
+                                               circle_center_x,
+                                               circle_center_y,
+                                               circle_radius);
+            }
+            if (!jacobians) {
+                return;
+            }
+
+#pragma omp simd
+            for (size_t i = 0; i < count; ++i) {
+                const double point_x = arguments[i];
+                const double point_y = arguments[count + i];
+                const double circle_center_x = arguments[2 * count + i];
+                const double circle_center_y = arguments[3 * count + i];
+                const double circle_radius = arguments[4 * count + i];
+
+                const double t0 = circle_center_x - point_x;
+                const double t1 = circle_center_y - point_y;
+                const double t2 = 1.0 / std::sqrt(t0 * t0 + t1 * t1);
+
+                jacobians[i] = -t0 * t2;
+                jacobians[count + i] = -t1 * t2;
+                jacobians[2 * count + i] = t0 * t2;
+                jacobians[3 * count + i] = t1 * t2;
+                jacobians[4 * count + i] = -(circle_radius < 0 ? -1 : 1);
+            }
+        }
+    };
 
     void add_to_problem(ceres::Problem& problem) {
-        problem.AddResidualBlock(gcs::create_scalar_autodiff(new Functor_0{}),
+        problem.AddResidualBlock(new CostFunction_0{},
                                  nullptr,
                                  &point->x.value,
                                  &point->y.value,
@@ -552,28 +1232,40 @@ struct PointOnCircle : gcs::Constraint {
                                  &circle->radius.value);
     }
 
-    std::vector<gcs::Equation*> get_equations() const {
+    std::vector<gcs::Equation*> get_equations(gcs::Arena& arena) const {
         std::vector<gcs::Equation*> eqns{};
 
-        eqns.push_back(
-            new Equation{{&point->x,
-                          &point->y,
-                          &circle->center.x,
-                          &circle->center.y,
-                          &circle->radius},
-                         [&](ceres::Problem& problem) {
-                             problem.AddResidualBlock(
-                                 gcs::create_scalar_autodiff(new Functor_0{}),
-                                 nullptr,
-                                 &point->x.value,
-                                 &point->y.value,
-                                 &circle->center.x.value,
-                                 &circle->center.y.value,
-                                 &circle->radius.value);
-                         }});
+        eqns.push_back(arena.make_equation(
+            {&point->x,
+             &point->y,
+             &circle->center.x,
+             &circle->center.y,
+             &circle->radius},
+            [&](ceres::Problem& problem) {
+                problem.AddResidualBlock(new CostFunction_0{},
+                                         nullptr,
+                                         &point->x.value,
+                                         &point->y.value,
+                                         &circle->center.x.value,
+                                         &circle->center.y.value,
+                                         &circle->radius.value);
+            },
+            "point_on_circle",
+            {&point->x.value,
+             &point->y.value,
+             &circle->center.x.value,
+             &circle->center.y.value,
+             &circle->radius.value},
+            &CostFunction_0::evaluate_batch));
 
         return eqns;
     }
+
+    const char* type_name() const { return "gcs.g2d.PointOnCircle"; }
+
+    std::vector<gcs::Constraint::Argument> get_arguments() const {
+        return {{point, nullptr}, {circle, nullptr}};
+    }
 };
 
 struct TangentLineCircle : gcs::Constraint {
@@ -605,9 +1297,91 @@ struct TangentLineCircle : gcs::Constraint {
             return true;
         }
     };
+    struct CostFunction_0 : ceres::SizedCostFunction<1, 1, 1, 1, 1, 1, 1, 1> {
+        bool Evaluate(double const* const* parameters,
+                      double* residuals,
+                      double** jacobians) const {
+            const double line_p1_x = parameters[0][0];
+            const double line_p1_y = parameters[1][0];
+            const double line_p2_x = parameters[2][0];
+            const double line_p2_y = parameters[3][0];
+            const double circle_center_x = parameters[4][0];
+            const double circle_center_y = parameters[5][0];
+            const double circle_radius = parameters[6][0];
+
+            residuals[0] = tangent_line_circle(line_p1_x,
+                                               line_p1_y,
+                                               line_p2_x,
+                                               line_p2_y,
+                                               circle_center_x,
+                                               circle_center_y,
+                                               circle_radius);
+            if (!jacobians) {
+                return true;
+            }
+
+            const double t0 = line_p1_x - line_p2_x;
+            const double t1 = circle_center_y - line_p1_y;
+            const double t2 = t0 * t0;
+            const double t3 = line_p1_y - line_p2_y;
+            const double t4 = t3 * t3;
+            const double t5 = std::sqrt(t2 + t4);
+            const double t6 = 1.0 / t5;
+            const double t7 = t0 * t6;
+            const double t8 = circle_center_x - line_p1_x;
+            const double t9 = -t3 * (-t5 + t7 * t8);
+            const double t10 = -circle_radius * t0;
+            const double t11 = t1 * t5;
+            const double t12 = t10 - t11;
+            const double t13 = -circle_radius * t3;
+            const double t14 = t5 * t8;
+            const double t15 = t13 + t14;
+            const double t16 = t10 + t11;
+            const double t17 = t13 - t14;
+            const bool t18 = t0 * t12 + t15 * t3 < -t0 * t16 - t17 * t3;
+            const double t19 = t3 * t6;
+            const double t20 = t1 * t19 - t5;
+            const double t21 = -t0 * t6;
+            const double t22 = -t3 * t8;
+            const double t23 = t21 * t22;
+            const double t24 = t1 * t21;
+
+            if (jacobians[0]) {
+                jacobians[0][0] =
+                    t18 ? -t0 * (circle_radius + t1 * t7) + t12 - t9
+                        : -t0 * (-circle_radius + t0 * t1 * t6) - t16 - t9;
+            }
+            if (jacobians[1]) {
+                jacobians[1][0] =
+                    t18 ? -t0 * t20 + t15 + t3 * (-circle_radius + t3 * t6 * t8)
+                        : -t0 * t20 - t17 + t3 * (circle_radius + t19 * t8);
+            }
+            if (jacobians[2]) {
+                jacobians[2][0] =
+                    t18 ? -t0 * (-circle_radius - t0 * t1 * t6) - t12 - t23
+                        : -t0 * (circle_radius + t24) + t16 - t23;
+            }
+            if (jacobians[3]) {
+                jacobians[3][0] =
+                    t18 ? t0 * t1 * t3 * t6 - t15 +
+                          t3 * (circle_radius + t22 * t6)
+                        : t17 - t24 * t3 + t3 * (-circle_radius - t3 * t6 * t8);
+            }
+            if (jacobians[4]) {
+                jacobians[4][0] = t3 * t5;
+            }
+            if (jacobians[5]) {
+                jacobians[5][0] = -t0 * t5;
+            }
+            if (jacobians[6]) {
+                jacobians[6][0] = t18 ? -t0 * t0 - t4 : t2 + t3 * t3;
+            }
+            return true;
+        }
+    };
 
     void add_to_problem(ceres::Problem& problem) {
-        problem.AddResidualBlock(gcs::create_scalar_autodiff(new Functor_0{}),
+        problem.AddResidualBlock(new CostFunction_0{},
                                  nullptr,
                                  &line->p1.x.value,
                                  &line->p1.y.value,
@@ -618,32 +1392,45 @@ struct TangentLineCircle : gcs::Constraint {
                                  &circle->radius.value);
     }
 
-    std::vector<gcs::Equation*> get_equations() const {
+    std::vector<gcs::Equation*> get_equations(gcs::Arena& arena) const {
         std::vector<gcs::Equation*> eqns{};
 
-        eqns.push_back(
-            new Equation{{&line->p1.x,
-                          &line->p1.y,
-                          &line->p2.x,
-                          &line->p2.y,
-                          &circle->center.x,
-                          &circle->center.y,
-                          &circle->radius},
-                         [&](ceres::Problem& problem) {
-                             problem.AddResidualBlock(
-                                 gcs::create_scalar_autodiff(new Functor_0{}),
-                                 nullptr,
-                                 &line->p1.x.value,
-                                 &line->p1.y.value,
-                                 &line->p2.x.value,
-                                 &line->p2.y.value,
-                                 &circle->center.x.value,
-                                 &circle->center.y.value,
-                                 &circle->radius.value);
-                         }});
+        eqns.push_back(arena.make_equation(
+            {&line->p1.x,
+             &line->p1.y,
+             &line->p2.x,
+             &line->p2.y,
+             &circle->center.x,
+             &circle->center.y,
+             &circle->radius},
+            [&](ceres::Problem& problem) {
+                problem.AddResidualBlock(new CostFunction_0{},
+                                         nullptr,
+                                         &line->p1.x.value,
+                                         &line->p1.y.value,
+                                         &line->p2.x.value,
+                                         &line->p2.y.value,
+                                         &circle->center.x.value,
+                                         &circle->center.y.value,
+                                         &circle->radius.value);
+            },
+            "tangent_line_circle",
+            {&line->p1.x.value,
+             &line->p1.y.value,
+             &line->p2.x.value,
+             &line->p2.y.value,
+             &circle->center.x.value,
+             &circle->center.y.value,
+             &circle->radius.value}));
 
         return eqns;
     }
+
+    const char* type_name() const { return "gcs.g2d.TangentLineCircle"; }
+
+    std::vector<gcs::Constraint::Argument> get_arguments() const {
+        return {{line, nullptr}, {circle, nullptr}};
+    }
 };
 
 struct TangentCircles : gcs::Constraint {
@@ -673,9 +1460,68 @@ struct TangentCircles : gcs::Constraint {
             return true;
         }
     };
+    struct CostFunction_0 : ceres::SizedCostFunction<1, 1, 1, 1, 1, 1, 1> {
+        bool Evaluate(double const* const* parameters,
+                      double* residuals,
+                      double** jacobians) const {
+            const double c1_center_x = parameters[0][0];
+            const double c1_center_y = parameters[1][0];
+            const double c1_radius = parameters[2][0];
+            const double c2_center_x = parameters[3][0];
+            const double c2_center_y = parameters[4][0];
+            const double c2_radius = parameters[5][0];
+
+            residuals[0] = tangent_circles(c1_center_x,
+                                           c1_center_y,
+                                           c1_radius,
+                                           c2_center_x,
+                                           c2_center_y,
+                                           c2_radius);
+            if (!jacobians) {
+                return true;
+            }
+
+            const double t0 = c1_center_x - c1_radius;
+            const double t1 = c1_center_y - c2_center_y;
+            const double t2 = std::sqrt(t0 * t0 + t1 * t1);
+            const double t3 = 1.0 / t2;
+            const double t4 = c2_center_x - c2_radius;
+            const bool t5 = t4 < 0;
+            const double t6 = c2_center_x + c2_radius;
+            const bool t7 = t6 < 0;
+            const double t8 = t2 + t4;
+            const double t9 = t2 + t6;
+            const double t10 = t2 - t6;
+            const double t11 = -c2_center_x + c2_radius + t2;
+            const bool t12 =
+                t5 && t7 ? t8 < t9
+                         : (t5 ? t8 < t10 : (t7 ? t11 < t9 : t11 < t10));
+            const double t13 = -(t7 ? -1 : 1);
+
+            if (jacobians[0]) {
+                jacobians[0][0] = t0 * t3;
+            }
+            if (jacobians[1]) {
+                jacobians[1][0] = t1 * t3;
+            }
+            if (jacobians[2]) {
+                jacobians[2][0] = -t0 * t3;
+            }
+            if (jacobians[3]) {
+                jacobians[3][0] = t12 ? -(t5 ? -1 : 1) : t13;
+            }
+            if (jacobians[4]) {
+                jacobians[4][0] = -t1 * t3;
+            }
+            if (jacobians[5]) {
+                jacobians[5][0] = t12 ? -(t5 ? 1 : -1) : t13;
+            }
+            return true;
+        }
+    };
 
     void add_to_problem(ceres::Problem& problem) {
-        problem.AddResidualBlock(gcs::create_scalar_autodiff(new Functor_0{}),
+        problem.AddResidualBlock(new CostFunction_0{},
                                  nullptr,
                                  &c1->center.x.value,
                                  &c1->center.y.value,
@@ -685,32 +1531,120 @@ struct TangentCircles : gcs::Constraint {
                                  &c2->radius.value);
     }
 
-    std::vector<gcs::Equation*> get_equations() const {
+    std::vector<gcs::Equation*> get_equations(gcs::Arena& arena) const {
         std::vector<gcs::Equation*> eqns{};
 
-        eqns.push_back(
-            new Equation{{&c1->center.x,
-                          &c1->center.y,
-                          &c1->radius,
-                          &c2->center.x,
-                          &c2->center.y,
-                          &c2->radius},
-                         [&](ceres::Problem& problem) {
-                             problem.AddResidualBlock(
-                                 gcs::create_scalar_autodiff(new Functor_0{}),
-                                 nullptr,
-                                 &c1->center.x.value,
-                                 &c1->center.y.value,
-                                 &c1->radius.value,
-                                 &c2->center.x.value,
-                                 &c2->center.y.value,
-                                 &c2->radius.value);
-                         }});
+        eqns.push_back(arena.make_equation(
+            {&c1->center.x,
+             &c1->center.y,
+             &c1->radius,
+             &c2->center.x,
+             &c2->center.y,
+             &c2->radius},
+            [&](ceres::Problem& problem) {
+                problem.AddResidualBlock(new CostFunction_0{},
+                                         nullptr,
+                                         &c1->center.x.value,
+                                         &c1->center.y.value,
+                                         &c1->radius.value,
+                                         &c2->center.x.value,
+                                         &c2->center.y.value,
+                                         &c2->radius.value);
+            },
+            "tangent_circles",
+            {&c1->center.x.value,
+             &c1->center.y.value,
+             &c1->radius.value,
+             &c2->center.x.value,
+             &c2->center.y.value,
+             &c2->radius.value}));
 
         return eqns;
     }
+
+    const char* type_name() const { return "gcs.g2d.TangentCircles"; }
+
+    std::vector<gcs::Constraint::Argument> get_arguments() const {
+        return {{c1, nullptr}, {c2, nullptr}};
+    }
 };
 
+//! Adds the constraints of this namespace to a registry, so that they can
+//! be loaded from a problem file
+inline void register_constraints(gcs::TypeRegistry& registry) {
+    registry.add_constraint(
+        "gcs.g2d.PointOnLine",
+        [](const gcs::ConstraintArguments& args) -> gcs::Constraint* {
+            return new PointOnLine{args.geometry<gcs::g2d::Point>(0),
+                                   args.geometry<gcs::g2d::Line>(1)};
+        });
+    registry.add_constraint(
+        "gcs.g2d.CoincidentPoints",
+        [](const gcs::ConstraintArguments& args) -> gcs::Constraint* {
+            return new CoincidentPoints{args.geometry<gcs::g2d::Point>(0),
+                                        args.geometry<gcs::g2d::Point>(1)};
+        });
+    registry.add_constraint(
+        "gcs.g2d.DistancePoints",
+        [](const gcs::ConstraintArguments& args) -> gcs::Constraint* {
+            return new DistancePoints{args.geometry<gcs::g2d::Point>(0),
+                                      args.geometry<gcs::g2d::Point>(1),
+                                      args.variable(2)};
+        });
+    registry.add_constraint(
+        "gcs.g2d.LineLength",
+        [](const gcs::ConstraintArguments& args) -> gcs::Constraint* {
+            return new LineLength{args.geometry<gcs::g2d::Line>(0),
+                                  args.variable(1)};
+        });
+    registry.add_constraint(
+        "gcs.g2d.OffsetLinePoint",
+        [](const gcs::ConstraintArguments& args) -> gcs::Constraint* {
+            return new OffsetLinePoint{args.geometry<gcs::g2d::Line>(0),
+                                       args.geometry<gcs::g2d::Point>(1),
+                                       args.variable(2)};
+        });
+    registry.add_constraint(
+        "gcs.g2d.AngleBetweenLines",
+        [](const gcs::ConstraintArguments& args) -> gcs::Constraint* {
+            return new AngleBetweenLines{args.geometry<gcs::g2d::Line>(0),
+                                         args.geometry<gcs::g2d::Line>(1),
+                                         args.variable(2)};
+        });
+    registry.add_constraint(
+        "gcs.g2d.AngleThreePoints",
+        [](const gcs::ConstraintArguments& args) -> gcs::Constraint* {
+            return new AngleThreePoints{args.geometry<gcs::g2d::Point>(0),
+                                        args.geometry<gcs::g2d::Point>(1),
+                                        args.geometry<gcs::g2d::Point>(2),
+                                        args.variable(3)};
+        });
+    registry.add_constraint(
+        "gcs.g2d.AngleOfLine",
+        [](const gcs::ConstraintArguments& args) -> gcs::Constraint* {
+            return new AngleOfLine{args.geometry<gcs::g2d::Line>(0),
+                                   args.variable(1)};
+        });
+    registry.add_constraint(
+        "gcs.g2d.PointOnCircle",
+        [](const gcs::ConstraintArguments& args) -> gcs::Constraint* {
+            return new PointOnCircle{args.geometry<gcs::g2d::Point>(0),
+                                     args.geometry<gcs::g2d::Circle>(1)};
+        });
+    registry.add_constraint(
+        "gcs.g2d.TangentLineCircle",
+        [](const gcs::ConstraintArguments& args) -> gcs::Constraint* {
+            return new TangentLineCircle{args.geometry<gcs::g2d::Line>(0),
+                                         args.geometry<gcs::g2d::Circle>(1)};
+        });
+    registry.add_constraint(
+        "gcs.g2d.TangentCircles",
+        [](const gcs::ConstraintArguments& args) -> gcs::Constraint* {
+            return new TangentCircles{args.geometry<gcs::g2d::Circle>(0),
+                                      args.geometry<gcs::g2d::Circle>(1)};
+        });
+}
+
 }  // namespace g2d
 
 }  // namespace gcs
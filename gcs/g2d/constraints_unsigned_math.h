@@ -8,9 +8,12 @@
 namespace gcs {
 
 //! @brief Set the distance between 2 points
+//! @note Uses sqrt rather than hypot, which has no vector form, so that the
+//! batch kernels of DistancePoints and PointOnCircle vectorize
 template <typename T>
 T distance(const T& x1, const T& y1, const T& x2, const T& y2, const T& d) {
-    return ceres::hypot(x2 - x1, y2 - y1) - ceres::abs(d);
+    return ceres::sqrt((x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1)) -
+           ceres::abs(d);
 }
 
 CSTR_CREATE_FUNCTOR_(distance, 5);
@@ -3,6 +3,7 @@
 
 #include <ceres/ceres.h>
 
+#include <string>
 #include <vector>
 
 #include "gcs/core/core.h"
@@ -18,6 +19,16 @@ struct Point : gcs::Geometry {
     Point(gcs::Variable x, gcs::Variable y) : x{x}, y{y} {}
 
     std::vector<gcs::Variable*> get_variables() { return {&x, &y}; }
+
+    const char* type_name() const { return "gcs.g2d.Point"; }
+
+    gcs::Geometry* find_geometry(const std::string& type,
+                                 const gcs::Variable* first) {
+        if (type == type_name() && first == &x) {
+            return this;
+        }
+        return nullptr;
+    }
 };
 
 struct Line : gcs::Geometry {
@@ -29,6 +40,22 @@ struct Line : gcs::Geometry {
     std::vector<gcs::Variable*> get_variables() {
         return {&p1.x, &p1.y, &p2.x, &p2.y};
     }
+
+    const char* type_name() const { return "gcs.g2d.Line"; }
+
+    gcs::Geometry* find_geometry(const std::string& type,
+                                 const gcs::Variable* first) {
+        if (type == type_name() && first == &p1.x) {
+            return this;
+        }
+        if (auto geom = p1.find_geometry(type, first)) {
+            return geom;
+        }
+        if (auto geom = p2.find_geometry(type, first)) {
+            return geom;
+        }
+        return nullptr;
+    }
 };
 
 struct Circle : gcs::Geometry {
@@ -41,8 +68,34 @@ struct Circle : gcs::Geometry {
     std::vector<gcs::Variable*> get_variables() {
         return {&center.x, &center.y, &radius};
     }
+
+    const char* type_name() const { return "gcs.g2d.Circle"; }
+
+    gcs::Geometry* find_geometry(const std::string& type,
+                                 const gcs::Variable* first) {
+        if (type == type_name() && first == &center.x) {
+            return this;
+        }
+        if (auto geom = center.find_geometry(type, first)) {
+            return geom;
+        }
+        return nullptr;
+    }
 };
 
+//! Adds the geometry of this namespace to a registry, so that it can be
+//! loaded from a problem file
+inline void register_geometry(gcs::TypeRegistry& registry) {
+    registry.add_geometry("gcs.g2d.Point",
+                          [] { return new gcs::g2d::Point{0.0, 0.0}; });
+    registry.add_geometry("gcs.g2d.Line", [] {
+        return new gcs::g2d::Line{{0.0, 0.0}, {0.0, 0.0}};
+    });
+    registry.add_geometry("gcs.g2d.Circle", [] {
+        return new gcs::g2d::Circle{{0.0, 0.0}, 0.0};
+    });
+}
+
 }  // namespace g2d
 
 }  // namespace gcs
@@ -0,0 +1,210 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "gcs/basic/basic.h"
+#include "gcs/core/core.h"
+#include "gcs/g2d/g2d.h"
+
+//! Evaluates a generated cost function and automatic differentiation of the
+//! functor of the same equation at the given values
+//!
+//! @returns the largest relative error of the residual and jacobians
+double jacobian_error(const ceres::CostFunction& analytic,
+                      const ceres::CostFunction& autodiff,
+                      const std::vector<double>& values) {
+    const size_t n = values.size();
+    std::vector<const double*> parameters(n);
+    double residual = 0.0;
+    double expected_residual = 0.0;
+    std::vector<double> jacobian(n);
+    std::vector<double> expected_jacobian(n);
+    std::vector<double*> jacobians(n);
+    std::vector<double*> expected_jacobians(n);
+    for (size_t i = 0; i < n; ++i) {
+        parameters[i] = &values[i];
+        jacobians[i] = &jacobian[i];
+        expected_jacobians[i] = &expected_jacobian[i];
+    }
+
+    analytic.Evaluate(parameters.data(), &residual, jacobians.data());
+    autodiff.Evaluate(
+        parameters.data(), &expected_residual, expected_jacobians.data());
+
+    auto error = [](double value, double expected) {
+        if (!std::isfinite(expected)) {
+            // not differentiable here, such as the distance between
+            // coincident points
+            return 0.0;
+        }
+        return std::abs(value - expected) / std::max(1.0, std::abs(expected));
+    };
+    double max_error = error(residual, expected_residual);
+    for (size_t i = 0; i < n; ++i) {
+        max_error =
+            std::max(max_error, error(jacobian[i], expected_jacobian[i]));
+    }
+    return max_error;
+}
+
+//! Compares the residual and jacobians of a generated cost function with
+//! automatic differentiation of the functor of the same equation
+//!
+//! The derivatives are checked at random real values, which almost surely
+//! avoid the kinks of abs and min, so any correct differentiation agrees
+//! there.
+//!
+//! They are checked separately at small integers, which often land on the
+//! kinks (such as collinear points or a zero distance). There the derivative
+//! isn't defined, and the generated code only matches because it breaks ties
+//! the way ceres does for Jets: abs(x) takes the +x branch at x == 0, and
+//! min(a, b) (std::min and ceres::fmin) returns a when a == b. Another
+//! backend, such as numeric differentiation, may legitimately disagree there.
+//!
+//! @returns true if both match to a relative tolerance
+template <typename CostFunction, typename Functor>
+bool check_jacobians(const char* name,
+                     const CostFunction& analytic,
+                     Functor* functor) {
+    std::unique_ptr<ceres::CostFunction> autodiff{
+        gcs::create_scalar_autodiff(functor)};
+    const size_t n = autodiff->parameter_block_sizes().size();
+    std::vector<double> values(n);
+
+    std::mt19937 rng{1};
+    std::uniform_real_distribution<double> distribution{-5.0, 5.0};
+    double max_error = 0.0;
+    for (int sample = 0; sample < 1000; ++sample) {
+        for (auto& value : values) {
+            value = distribution(rng);
+        }
+        max_error =
+            std::max(max_error, jacobian_error(analytic, *autodiff, values));
+    }
+
+    // the tie-breaking of abs and min at their kinks, as above
+    std::uniform_int_distribution<int> integers{-2, 2};
+    double max_kink_error = 0.0;
+    for (int sample = 0; sample < 1000; ++sample) {
+        for (auto& value : values) {
+            value = integers(rng);
+        }
+        max_kink_error = std::max(max_kink_error,
+                                  jacobian_error(analytic, *autodiff, values));
+    }
+
+    std::cout << name << ": max error " << max_error << ", at kinks "
+              << max_kink_error << std::endl;
+    return max_error < 1e-9 && max_kink_error < 1e-9;
+}
+
+//! Compares a batch kernel with the cost function it belongs to, on a batch of
+//! random values that doesn't fill a whole number of vector registers
+//!
+//! @returns true if they match to a relative tolerance
+template <typename CostFunction>
+bool check_batch(const char* name, const CostFunction& analytic) {
+    const size_t n = analytic.parameter_block_sizes().size();
+    const size_t count = 1001;
+
+    std::mt19937 rng{2};
+    std::uniform_real_distribution<double> distribution{-5.0, 5.0};
+    std::vector<double> arguments(n * count);
+    for (auto& argument : arguments) {
+        argument = distribution(rng);
+    }
+
+    std::vector<double> residuals(count);
+    std::vector<double> jacobians(n * count);
+    CostFunction::evaluate_batch(
+        count, arguments.data(), residuals.data(), jacobians.data());
+
+    double max_error = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+        std::vector<double> values(n);
+        std::vector<const double*> parameters(n);
+        std::vector<double> jacobian(n);
+        std::vector<double*> jacobian_ptrs(n);
+        for (size_t a = 0; a < n; ++a) {
+            values[a] = arguments[a * count + i];
+            parameters[a] = &values[a];
+            jacobian_ptrs[a] = &jacobian[a];
+        }
+
+        double residual = 0.0;
+        analytic.Evaluate(parameters.data(), &residual, jacobian_ptrs.data());
+
+        auto error = [](double value, double expected) {
+            return std::abs(value - expected) /
+                   std::max(1.0, std::abs(expected));
+        };
+        max_error = std::max(max_error, error(residuals[i], residual));
+        for (size_t a = 0; a < n; ++a) {
+            max_error = std::max(
+                max_error, error(jacobians[a * count + i], jacobian[a]));
+        }
+    }
+
+    std::cout << name << " batch: max error " << max_error << std::endl;
+    return max_error < 1e-12;
+}
+
+int main(int argc, char** argv) {
+    using namespace gcs::basic;
+    using namespace gcs::g2d;
+
+    double value = 2.0;
+    bool ok = true;
+
+    ok &= check_jacobians("SetConstant",
+                          SetConstant::CostFunction_0{&value},
+                          new SetConstant::Functor_0{&value});
+    ok &= check_jacobians(
+        "Equate", Equate::CostFunction_0{}, new Equate::Functor_0{});
+    ok &= check_jacobians("Difference",
+                          Difference::CostFunction_0{},
+                          new Difference::Functor_0{});
+    ok &= check_jacobians("PointOnLine",
+                          PointOnLine::CostFunction_0{},
+                          new PointOnLine::Functor_0{});
+    ok &= check_jacobians("CoincidentPoints",
+                          CoincidentPoints::CostFunction_0{},
+                          new CoincidentPoints::Functor_0{});
+    ok &= check_jacobians("DistancePoints",
+                          DistancePoints::CostFunction_0{},
+                          new DistancePoints::Functor_0{});
+    ok &= check_jacobians("LineLength",
+                          LineLength::CostFunction_0{},
+                          new LineLength::Functor_0{});
+    ok &= check_jacobians("OffsetLinePoint",
+                          OffsetLinePoint::CostFunction_0{},
+                          new OffsetLinePoint::Functor_0{});
+    ok &= check_jacobians("AngleBetweenLines",
+                          AngleBetweenLines::CostFunction_0{},
+                          new AngleBetweenLines::Functor_0{});
+    ok &= check_jacobians("AngleThreePoints",
+                          AngleThreePoints::CostFunction_0{},
+                          new AngleThreePoints::Functor_0{});
+    ok &= check_jacobians("AngleOfLine",
+                          AngleOfLine::CostFunction_0{},
+                          new AngleOfLine::Functor_0{});
+    ok &= check_jacobians("PointOnCircle",
+                          PointOnCircle::CostFunction_0{},
+                          new PointOnCircle::Functor_0{});
+    ok &= check_jacobians("TangentLineCircle",
+                          TangentLineCircle::CostFunction_0{},
+                          new TangentLineCircle::Functor_0{});
+    ok &= check_jacobians("TangentCircles",
+                          TangentCircles::CostFunction_0{},
+                          new TangentCircles::Functor_0{});
+
+    ok &= check_batch("PointOnLine", PointOnLine::CostFunction_0{});
+    ok &= check_batch("DistancePoints", DistancePoints::CostFunction_0{});
+    ok &= check_batch("PointOnCircle", PointOnCircle::CostFunction_0{});
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
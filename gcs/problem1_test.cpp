@@ -1,10 +1,286 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
 
 #include "gcs/basic/basic.h"
 #include "gcs/core/core.h"
 #include "gcs/g2d/g2d.h"
 
+//! Makes an empty file in the test's temporary directory
+//!
+//! @param name a file name ending in XXXXXX, which mkstemp replaces
+//! @returns the path of the file, or an empty string if it can't be made
+std::string temp_path(const std::string& name) {
+    const char* tmp_dir = std::getenv("TEST_TMPDIR");
+    if (!tmp_dir) {
+        tmp_dir = std::getenv("TMPDIR");
+    }
+    std::string path = std::string{tmp_dir ? tmp_dir : "/tmp"} + "/" + name;
+
+    int fd = mkstemp(&path[0]);
+    if (fd < 0) {
+        return {};
+    }
+    ::close(fd);
+    return path;
+}
+
+//! A strip of equilateral triangles, where each new point is located by its
+//! distances to the two points before it
+struct TriangleStrip {
+    std::vector<std::unique_ptr<gcs::g2d::Point>> points;
+    std::vector<std::unique_ptr<gcs::Variable>> distances;
+    std::vector<std::unique_ptr<gcs::Constraint>> constraints;
+    gcs::Problem problem;
+    double side;
+
+    //! Makes the strip and adds it to the problem, which splits and solves it
+    TriangleStrip(size_t num_triangles, double side) : side{side} {
+        for (size_t i = 0; i < num_triangles + 2; ++i) {
+            points.emplace_back(new gcs::g2d::Point{0.0, 0.0});
+        }
+        reset();
+
+        auto& p0 = *points[0];
+        auto& p1 = *points[1];
+        constraints.emplace_back(new gcs::basic::SetConstant{p0.x, p0.x.value});
+        constraints.emplace_back(new gcs::basic::SetConstant{p0.y, p0.y.value});
+        constraints.emplace_back(new gcs::basic::SetConstant{p1.x, p1.x.value});
+        constraints.emplace_back(new gcs::basic::SetConstant{p1.y, p1.y.value});
+
+        for (size_t i = 2; i < points.size(); ++i) {
+            distances.emplace_back(new gcs::Variable{side});
+            auto& d = *distances.back();
+            constraints.emplace_back(new gcs::basic::SetConstant{d, side});
+            constraints.emplace_back(
+                new gcs::g2d::DistancePoints{*points[i - 2], *points[i], d});
+            constraints.emplace_back(
+                new gcs::g2d::DistancePoints{*points[i - 1], *points[i], d});
+        }
+
+        gcs::Problem::EditScope edit{problem};
+        for (auto& constraint : constraints) {
+            problem.add(constraint.get());
+        }
+    }
+
+    //! Moves the points to their initial guesses, which are near the solution
+    //! with the points alternating above and below the x axis
+    void reset() {
+        const double height = side * std::sqrt(3.0) / 2.0;
+        for (size_t i = 0; i < points.size(); ++i) {
+            const double noise = i < 2 ? 0.0 : 0.1 * side;
+            points[i]->x.value = i * side / 2.0 + noise;
+            points[i]->y.value = (i % 2 ? height : 0.0) - noise;
+        }
+    }
+
+    //! @returns the coordinates of all points
+    std::vector<double> coordinates() const {
+        std::vector<double> values{};
+        for (auto& point : points) {
+            values.push_back(point->x.value);
+            values.push_back(point->y.value);
+        }
+        return values;
+    }
+
+    //! @returns the values of all variables: the coordinates of the points,
+    //! then the distances
+    std::vector<double> values() const {
+        auto values = coordinates();
+        for (auto& distance : distances) {
+            values.push_back(distance->value);
+        }
+        return values;
+    }
+};
+
+//! Saves a split problem, then maps, loads and solves it
+//!
+//! @param problem the problem from main, which is split and solved
+//! @param length the solved length of L1
+//! @returns true if the loaded problem has the same equation sets and solves
+//! to the same length of L1
+bool check_round_trip(gcs::Problem& problem, double length) {
+    gcs::TypeRegistry registry{};
+    gcs::basic::register_constraints(registry);
+    gcs::g2d::register_geometry(registry);
+    gcs::g2d::register_constraints(registry);
+
+    const std::string path = temp_path("problem1_XXXXXX");
+    if (path.empty() || !gcs::save_problem(problem, path)) {
+        std::cout << "Failed to save the problem" << std::endl;
+        return false;
+    }
+
+    bool ok = false;
+    gcs::MappedProblemFile file{};
+    std::unique_ptr<gcs::LoadedProblem> loaded{};
+    if (!file.open(path)) {
+        std::cout << "Failed to map the problem file" << std::endl;
+    } else if (!(loaded = gcs::load_problem(file, registry))) {
+        std::cout << "Failed to load the problem" << std::endl;
+    } else {
+        ok = loaded->problem.solve().success();
+        std::cout << "Loaded equation sets: "
+                  << loaded->problem.equation_sets.size() << std::endl;
+        ok &= loaded->problem.equation_sets.size() ==
+              problem.equation_sets.size();
+
+        size_t num_lines = 0;
+        for (auto& geom : loaded->geometries) {
+            if (std::string{geom->type_name()} == "gcs.g2d.Line") {
+                auto& line = static_cast<gcs::g2d::Line&>(*geom);
+                const double loaded_length =
+                    std::hypot(line.p2.x.value - line.p1.x.value,
+                               line.p2.y.value - line.p1.y.value);
+                std::cout << "Loaded L1 length: " << loaded_length
+                          << std::endl;
+                ok &= std::abs(loaded_length - length) < 1e-6;
+                ++num_lines;
+            }
+        }
+        ok &= num_lines == 1;
+    }
+
+    loaded.reset();
+    file.close();
+    std::remove(path.c_str());
+
+    std::cout << "Round trip: " << (ok ? "matches" : "MISMATCH") << std::endl;
+    return ok;
+}
+
+//! Checks the results of sweeping the length of L1 in main
+//!
+//! @param sweep the results, whose outputs are the coordinates of L1
+//! @param lengths the length of L1 in each sample
+//! @returns true if every sample converged to its length
+bool check_sweep(const gcs::SweepResult& sweep,
+                 const std::vector<double>& lengths) {
+    bool ok = sweep.num_samples == lengths.size() && sweep.num_outputs == 4;
+    for (size_t i = 0; ok && i < sweep.num_samples; ++i) {
+        const double length = std::hypot(sweep.at(i, 2) - sweep.at(i, 0),
+                                         sweep.at(i, 3) - sweep.at(i, 1));
+        ok &= sweep.results[i].success();
+        ok &= std::abs(length - lengths[i]) < 1e-6;
+    }
+
+    std::cout << "Sweep of " << lengths.size()
+              << " samples: " << (ok ? "matches" : "MISMATCH") << std::endl;
+    return ok;
+}
+
+//! Solves two problems of different sizes in one batch, and checks that each
+//! result belongs to its own problem and matches solving it alone
+//!
+//! @returns true if the batch solve matches
+bool check_solve_batch() {
+    TriangleStrip small{2, 1.0};
+    TriangleStrip large{6, 2.0};
+    std::vector<TriangleStrip*> strips{&small, &large};
+
+    std::vector<std::vector<double>> expected{};
+    std::vector<gcs::Problem*> problems{};
+    for (auto strip : strips) {
+        strip->reset();
+        strip->problem.solve();
+        expected.push_back(strip->coordinates());
+
+        strip->reset();
+        problems.push_back(&strip->problem);
+    }
+
+    auto results = gcs::solve_batch(problems);
+
+    bool ok = results.size() == strips.size();
+    for (size_t i = 0; ok && i < strips.size(); ++i) {
+        ok &= results[i].success();
+        ok &= results[i].num_equation_sets ==
+              strips[i]->problem.equation_sets.size();
+
+        auto actual = strips[i]->coordinates();
+        for (size_t k = 0; k < actual.size(); ++k) {
+            ok &= std::abs(actual[k] - expected[i][k]) < 1e-9;
+        }
+    }
+
+    std::cout << "Batch solve: " << (ok ? "matches" : "MISMATCH") << std::endl;
+    return ok;
+}
+
+//! Takes snapshots of a problem and restores them, with the same slots, after
+//! the slots are laid out again, and when a failed solve is rolled back
+//!
+//! @returns true if the values match the snapshot each time
+bool check_snapshots() {
+    TriangleStrip strip{4, 1.0};
+    auto& problem = strip.problem;
+    auto& side = static_cast<gcs::basic::SetConstant&>(*strip.constraints[4]);
+    bool ok = true;
+
+    auto check = [&ok](const char* name, bool matches) {
+        std::cout << name << ": " << (matches ? "matches" : "MISMATCH")
+                  << std::endl;
+        ok &= matches;
+    };
+
+    // nothing was solved in between, so all pages are shared
+    const auto solved = strip.values();
+    auto before = problem.snapshot();
+    auto unchanged = problem.snapshot();
+    check("Unchanged snapshot",
+          before.num_pages() > 0 &&
+              unchanged.num_shared_pages(before) == before.num_pages());
+
+    // solve for another side, then move the points as well
+    side.value = 1.5;
+    problem.solve();
+    strip.reset();
+    bool moved = strip.values() != solved;
+    problem.restore(before);
+    check("Snapshot restore", moved && strip.values() == solved);
+    side.value = 1.0;
+
+    // without incremental edits, removing and adding a constraint lays out
+    // the slots again, so the snapshot is restored across the new layout
+    problem.incremental = false;
+    problem.remove(strip.constraints.back().get());
+    problem.add(strip.constraints.back().get());
+    side.value = 1.5;
+    problem.solve();
+    moved = strip.values() != solved &&
+            problem.snapshot().num_shared_pages(before) == 0;
+    problem.restore(before);
+    check("Snapshot restore after re-split", moved && strip.values() == solved);
+    side.value = 1.0;
+
+    // a side that isn't a number fails to solve, so the values are rolled
+    // back to the end of the last solve
+    auto pre_solve = problem.snapshot();
+    side.value = std::nan("");
+    auto result = problem.solve();
+    check("Rollback",
+          !result.success() && result.rolled_back &&
+              strip.values() == solved &&
+              problem.snapshot().num_shared_pages(pre_solve) ==
+                  pre_solve.num_pages());
+    side.value = 1.0;
+    ok &= problem.solve().success();
+
+    return ok;
+}
+
 int main(int argc, char** argv) {
+    bool ok = true;
+
     const double r0 = 1.5;
     const double d = 3.0;
     const double a = M_PI / 6.0;
@@ -50,9 +326,15 @@ int main(int argc, char** argv) {
 
     // make problem, split, and solve
     gcs::Problem gcs_problem{};
+    gcs_problem.tracer = std::make_shared<gcs::Tracer>();
 
-    for (auto& constraint : constraints) {
-        gcs_problem.add(constraint);
+    {
+        // add all constraints with a single split and solve
+        gcs::Problem::EditScope edit{gcs_problem};
+
+        for (auto& constraint : constraints) {
+            gcs_problem.add(constraint);
+        }
     }
 
     gcs_problem.split();
@@ -60,7 +342,33 @@ int main(int argc, char** argv) {
               << std::endl
               << std::flush;
 
-    gcs_problem.solve();
+    gcs_problem.reset_to_single_equation_set();
+    gcs_problem.split(gcs::SplitMethod::frontier_search);
+    std::cout << "Split using frontier search: "
+              << gcs_problem.equation_sets.size() << std::endl
+              << std::flush;
+
+    gcs_problem.reset_to_single_equation_set();
+    gcs_problem.split(gcs::SplitMethod::block_triangular);
+    std::cout << "Split using block triangular decomposition: "
+              << gcs_problem.equation_sets.size() << std::endl
+              << std::flush;
+
+    gcs_problem.use_presolve = true;
+    gcs_problem.reset_to_single_equation_set();
+    gcs_problem.split();
+    std::cout << "Split after presolve: " << gcs_problem.equation_sets.size()
+              << " (" << gcs_problem.presolved.eliminations.size()
+              << " equations eliminated)" << std::endl
+              << std::flush;
+
+    gcs_problem.record_telemetry = true;
+    auto result = gcs_problem.solve();
+    for (auto& record : result.records) {
+        std::cout << "Solved " << record.num_equations << " equations "
+                  << (record.direct ? "directly" : "with ceres") << " in "
+                  << record.iterations << " iterations" << std::endl;
+    }
 
     std::cout << "p2.x: " << p2.x.value << std::endl;
     std::cout << "p2.y: " << p2.y.value << std::endl;
@@ -68,7 +376,68 @@ int main(int argc, char** argv) {
     std::cout << "p3.y: " << p3.y.value << std::endl;
     std::cout << "c1.r:  " << c1.radius.value << std::endl;
 
+    // change a driving dimension and only re-solve what depends on it
+    auto line_length = static_cast<gcs::basic::SetConstant*>(constraints[3]);
+    line_length->value = 2.5;
+    gcs_problem.mark_dirty(line_length);
+    gcs_problem.solve_dirty();
+
+    std::cout << "L1 length: "
+              << std::hypot(L1.p2.x.value - L1.p1.x.value,
+                            L1.p2.y.value - L1.p1.y.value)
+              << std::endl;
+
+    // solve for a few line lengths, reusing the split
+    const std::vector<double> lengths = {2.0, 3.0, 4.0};
+    auto sweep = gcs_problem.sweep({{line_length, &line_length->value}},
+                                   lengths,
+                                   {&L1.p1.x, &L1.p1.y, &L1.p2.x, &L1.p2.y});
+    for (size_t i = 0; i < sweep.num_samples; ++i) {
+        std::cout << "Sweep " << i << ": p2 = (" << sweep.at(i, 2) << ", "
+                  << sweep.at(i, 3) << ")" << std::endl;
+    }
+    ok &= check_sweep(sweep, lengths);
+
+    // without presolve, the samples are solved in parallel chains (four of
+    // them, even if there are fewer cores)
+    gcs_problem.use_presolve = false;
+    gcs_problem.reset_to_single_equation_set();
+    gcs_problem.split();
+
+    std::vector<double> more_lengths{};
+    for (int i = 0; i < 16; ++i) {
+        more_lengths.push_back(2.0 + 0.125 * i);
+    }
+    ok &= check_sweep(
+        gcs_problem.sweep({{line_length, &line_length->value}},
+                          more_lengths,
+                          {&L1.p1.x, &L1.p1.y, &L1.p2.x, &L1.p2.y},
+                          4),
+        more_lengths);
+
+    // the sweep leaves the problem as it was
+    const double length = std::hypot(L1.p2.x.value - L1.p1.x.value,
+                                     L1.p2.y.value - L1.p1.y.value);
+    if (std::abs(length - 2.5) > 1e-6) {
+        std::cout << "Sweep changed L1 length to " << length << std::endl;
+        ok = false;
+    }
+
+    // save the split problem, then load and solve it without splitting again
+    ok &= check_round_trip(gcs_problem, length);
+
+    const std::string trace_path = temp_path("problem1_trace_XXXXXX");
+    if (!trace_path.empty() && gcs_problem.tracer->write(trace_path)) {
+        std::cout << "Trace written" << std::endl;
+    }
+    std::remove(trace_path.c_str());
+
     for (auto& cstr : constraints) {
         gcs_problem.remove(cstr);
     }
+
+    ok &= check_solve_batch();
+    ok &= check_snapshots();
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -3,8 +3,105 @@ import itertools as it
 from pathlib import Path
 
 from pydantic import BaseModel, validator
+import sympy
+from sympy.printing.cxx import CXX11CodePrinter
 
 
+class IsLess(sympy.logic.boolalg.BooleanFunction):
+    # a < b, kept as written so that sympy doesn't rearrange the branches of
+    # abs and min
+    nargs = 2
+
+    @classmethod
+    def eval(cls, a, b):
+        return None
+
+
+def make_abs(a):
+    # same branch as ceres::abs
+    return sympy.Piecewise((-a, IsLess(a, 0)), (a, True))
+
+
+def make_min(a, b):
+    # same branch as std::min and ceres::fmin
+    return sympy.Piecewise((b, IsLess(b, a)), (a, True))
+
+
+class ResidualFunction(BaseModel):
+    # symbolic form of a residual function in the math headers, which is
+    # differentiated to make the analytic jacobians of its equations
+    funcname: str
+    arguments: List[str]
+    expression: str
+
+    def get_expression(self, residual_functions) -> sympy.Expr:
+        symbols = {arg: sympy.Symbol(arg, real=True) for arg in self.arguments}
+
+        # functions defined earlier in the file can be called by name
+        functions = {}
+        for name, fn in residual_functions.items():
+            if name == self.funcname:
+                break
+            params = tuple(sympy.Symbol(arg, real=True) for arg in fn.arguments)
+            functions[name] = sympy.Lambda(params, fn.get_expression(residual_functions))
+
+        # abs and min take the same branches as the math headers, so the
+        # derivatives match automatic differentiation even where they are
+        # discontinuous
+        functions['Abs'] = make_abs
+        functions['Min'] = make_min
+
+        return sympy.sympify(self.expression, locals={**functions, **symbols})
+
+    def get_gradient(self, residual_functions) -> List[sympy.Expr]:
+        expr = self.get_expression(residual_functions)
+        return [sympy.diff(expr, sympy.Symbol(arg, real=True)) for arg in self.arguments]
+
+
+class CostFunctionPrinter(CXX11CodePrinter):
+    # prints squares and square roots without pow, and piecewise expressions as
+    # a single line conditional
+
+    def _print_Pow(self, expr):
+        base = self.parenthesize(expr.base, sympy.printing.precedence.PRECEDENCE['Mul'])
+        if expr.exp == 2:
+            return f'{base} * {base}'
+        if expr.exp == sympy.Rational(1, 2):
+            return f'std::sqrt({self._print(expr.base)})'
+        if expr.exp == -sympy.Rational(1, 2):
+            return f'1.0 / std::sqrt({self._print(expr.base)})'
+        if expr.exp == -1:
+            return f'1.0 / {base}'
+        if expr.exp == -2:
+            return f'1.0 / ({base} * {base})'
+        return super()._print_Pow(expr)
+
+    def _print_atan2(self, expr):
+        # cse turns a - b into -(b - a), which is -0.0 rather than 0.0 when
+        # a == b, and atan2 tells the two apart
+        args = []
+        for arg in expr.args:
+            if arg.is_Mul and arg.could_extract_minus_sign():
+                args.append(f'0.0 - {self.parenthesize(-arg, sympy.printing.precedence.PRECEDENCE["Add"])}')
+            else:
+                args.append(self._print(arg))
+        return f'std::atan2({", ".join(args)})'
+
+    def _print_IsLess(self, expr):
+        return f'{self._print(expr.args[0])} < {self._print(expr.args[1])}'
+
+    def _print_Piecewise(self, expr):
+        result = self._print(expr.args[-1].expr)
+        for branch, cond in reversed(expr.args[:-1]):
+            result = f'({self._print(cond)} ? {self._print(branch)} : {result})'
+        return result
+
+
+def is_condition(expr) -> bool:
+    if isinstance(expr, sympy.Piecewise):
+        return all(is_condition(branch) for branch, _ in expr.args)
+    return isinstance(expr, sympy.logic.boolalg.Boolean)
+
 
 class GeometryReference(BaseModel):
     type: str
@@ -22,9 +119,24 @@ class GeometryDefinition(BaseModel):
         ns = self.namespace.replace('.', '::')
         return f'{ns}::{self.classname}'
 
+    @property
+    def typename(self):
+        # name used to make the geometry again when a problem file is loaded
+        return f'{self.namespace}.{self.classname}'
+
     def get_all_vars(self, geom_types) -> List[str]:
         return sum(([f"{gref.name}.{var}" for var in geom_types[gref.type].get_all_vars(geom_types)] for gref in self.geoms), []) + self.variables
 
+    def make_initializer(self, geom_types) -> str:
+        # braced initializer that makes this geometry with all values zero
+        return '{' + ', '.join(
+            [geom_types[gref.type].make_initializer(geom_types) for gref in self.geoms]
+            + ['0.0' for _ in self.variables]
+        ) + '}'
+
+    def make_registration(self, geom_types) -> str:
+        return f'    registry.add_geometry("{self.typename}", [] {{ return new {self.fullname}{self.make_initializer(geom_types)}; }});'
+
     def make_struct(self, geom_types) -> str:
         param_names = (
             [(geom_types[gref.type].fullname, gref.name) for gref in self.geoms]
@@ -41,7 +153,22 @@ class GeometryDefinition(BaseModel):
                 '',
                 '    std::vector<gcs::Variable*> get_variables() {',  # TODO: get_variables const?
                 '        return {' + ', '.join([f'&{var}' for var in self.get_all_vars(geom_types)]) + '};',
-                '    }'
+                '    }',
+                '',
+                f'    const char* type_name() const {{ return "{self.typename}"; }}',
+                '',
+                '    gcs::Geometry* find_geometry(const std::string& type, const gcs::Variable* first) {',
+                f'        if (type == type_name() && first == &{self.get_all_vars(geom_types)[0]}) {{',
+                '            return this;',
+                '        }',
+            ]
+            + [
+                f'        if (auto geom = {gref.name}.find_geometry(type, first)) {{\n            return geom;\n        }}'
+                for gref in self.geoms
+            ]
+            + [
+                '        return nullptr;',
+                '    }',
             ]
             + ['};']
         ) 
@@ -55,6 +182,9 @@ class EquationUsage(BaseModel):
     funcname: str
     variables: Union[Literal["all"], List[str]] = "all"
     ftor_args: List[FtorArg] = []
+    # also generate a kernel that evaluates many equations of this constraint
+    # at once, for constraints that are common in large problems
+    batch: bool = False
 
     def get_variables(self, constraint: 'Constraint', geom_types):
         return constraint.get_all_vars(geom_types) if self.variables == 'all' else self.variables
@@ -69,22 +199,173 @@ class EquationUsage(BaseModel):
             f'    struct Functor_{functor_suffix} {{',
             f'        static const metal::int_ num_params = {len(variables)};',
         ] + [
-            f'        double {arg.name};' for arg in self.ftor_args
+            f'        const double* {arg.name};' for arg in self.ftor_args
         ] + [
             '',
             f'        template <typename T>',
             '        bool operator()(' + ''.join((f'const T* {var}, ' for var in variables)) + 'T* r) const {',
-            f'            *r = {self.funcname}(' + ', '.join([f'*{var}' for var in variables] + [arg.name for arg in self.ftor_args]) + ');',
+            f'            *r = {self.funcname}(' + ', '.join([f'*{var}' for var in variables] + [f'*{arg.name}' for arg in self.ftor_args]) + ');',
             '            return true;',
             '        }',
             '    };',
         ])
 
-    def make_residual_statement(self, constraint: 'Constraint', functor_suffix, geom_types):
+    def make_cost_function(self, constraint: 'Constraint', geom_types, residual_functions, functor_suffix) -> str:
+        # cost function with the same residual as the functor, and jacobians
+        # from the derivatives of the residual function
+        variables = [var.replace(".", "_") for var in self.get_variables(constraint, geom_types)]
+        residual_function = residual_functions[self.funcname]
+        assert len(residual_function.arguments) == len(variables) + len(self.ftor_args), \
+            f'{constraint.classname} calls {self.funcname} with the wrong number of arguments'
+
+        # name the arguments after the values they are called with
+        names = variables + [f'*{arg.name}' for arg in self.ftor_args]
+        renamed = {
+            sympy.Symbol(arg, real=True): sympy.Symbol(name, real=True)
+            for arg, name in zip(residual_function.arguments, names)
+        }
+        gradient = [
+            derivative.xreplace(renamed)
+            for derivative in residual_function.get_gradient(residual_functions)[:len(variables)]
+        ]
+        subexpressions, gradient = self.eliminate_subexpressions(gradient)
+
+        printer = CostFunctionPrinter()
+        classname = f'CostFunction_{functor_suffix}'
+
+        return '\n'.join(
+            [
+                f'    struct {classname} : ceres::SizedCostFunction<1' + ''.join(', 1' for _ in variables) + '> {',
+            ]
+            + [f'        const double* {arg.name};' for arg in self.ftor_args]
+            + (
+                [
+                    '',
+                    f'        explicit {classname}(' + ', '.join(f'const double* {arg.name}' for arg in self.ftor_args) + ')',
+                    '            : ' + ', '.join(f'{arg.name}{{{arg.name}}}' for arg in self.ftor_args) + ' {}',
+                    '',
+                ]
+                if self.ftor_args else []
+            )
+            + [
+                '        bool Evaluate(double const* const* parameters, double* residuals, double** jacobians) const {',
+            ]
+            + [f'            const double {var} = parameters[{i}][0];' for i, var in enumerate(variables)]
+            + [
+                '',
+                f'            residuals[0] = {self.funcname}(' + ', '.join(names) + ');',
+                '            if (!jacobians) {',
+                '                return true;',
+                '            }',
+                '',
+            ]
+            + [
+                # cse also factors out the conditions of branches
+                f'            const {"bool" if is_condition(expr) else "double"} {symbol} = {printer.doprint(expr)};'
+                for symbol, expr in subexpressions
+            ]
+            + ([''] if subexpressions else [])
+            + [
+                f'            if (jacobians[{i}]) {{\n                jacobians[{i}][0] = {printer.doprint(derivative)};\n            }}'
+                for i, derivative in enumerate(gradient)
+            ]
+            + [
+                '            return true;',
+                '        }',
+            ]
+            + (['', self.make_batch_kernel(constraint, geom_types, residual_functions)] if self.batch else [])
+            + [
+                '    };',
+            ]
+        )
+
+    def make_batch_kernel(self, constraint: 'Constraint', geom_types, residual_functions) -> str:
+        # static function with the signature of gcs::BatchKernel, which reads
+        # every argument (including the ftor args) from the batch, so that the
+        # loops have no branches or indirection. The loops are marked omp simd,
+        # which the targets build with -fopenmp-simd, so they are vectorized
+        # even where the compiler can't prove it safe by itself
+        names = [var.replace(".", "_") for var in self.get_variables(constraint, geom_types)] + [arg.name for arg in self.ftor_args]
+        residual_function = residual_functions[self.funcname]
+
+        renamed = {
+            sympy.Symbol(arg, real=True): sympy.Symbol(name, real=True)
+            for arg, name in zip(residual_function.arguments, names)
+        }
+        gradient = [derivative.xreplace(renamed) for derivative in residual_function.get_gradient(residual_functions)]
+        subexpressions, gradient = self.eliminate_subexpressions(gradient)
+
+        printer = CostFunctionPrinter()
+
+        def offset(i):
+            return 'i' if i == 0 else 'count + i' if i == 1 else f'{i} * count + i'
+
+        loads = [f'                const double {name} = arguments[{offset(i)}];' for i, name in enumerate(names)]
+
+        return '\n'.join(
+            [
+                '        static void evaluate_batch(size_t count, const double* arguments, double* residuals, double* jacobians) {',
+                '#pragma omp simd',
+                '            for (size_t i = 0; i < count; ++i) {',
+            ]
+            + loads
+            + [
+                '',
+                f'                residuals[i] = {self.funcname}(' + ', '.join(names) + ');',
+                '            }',
+                '            if (!jacobians) {',
+                '                return;',
+                '            }',
+                '',
+                '#pragma omp simd',
+                '            for (size_t i = 0; i < count; ++i) {',
+            ]
+            + loads
+            + ['']
+            + [
+                f'                const {"bool" if is_condition(expr) else "double"} {symbol} = {printer.doprint(expr)};'
+                for symbol, expr in subexpressions
+            ]
+            + ([''] if subexpressions else [])
+            + [
+                f'                jacobians[{offset(i)}] = {printer.doprint(derivative)};'
+                for i, derivative in enumerate(gradient)
+            ]
+            + [
+                '            }',
+                '        }',
+            ]
+        )
+
+    @staticmethod
+    def eliminate_subexpressions(gradient):
+        subexpressions, gradient = sympy.cse(gradient, symbols=sympy.numbered_symbols('t'))
+
+        # put back subexpressions that only negate a value
+        trivial = {symbol: expr for symbol, expr in subexpressions if expr.is_Mul and (-expr).is_Symbol}
+        subexpressions = [(symbol, expr.xreplace(trivial)) for symbol, expr in subexpressions if symbol not in trivial]
+        gradient = [derivative.xreplace(trivial) for derivative in gradient]
+
+        numbered = {symbol: sympy.Symbol(f't{i}') for i, (symbol, _) in enumerate(subexpressions)}
+        subexpressions = [(numbered[symbol], expr.xreplace(numbered)) for symbol, expr in subexpressions]
+        gradient = [derivative.xreplace(numbered) for derivative in gradient]
+
+        return subexpressions, gradient
+
+    def make_cost_function_instantiation(self, residual_functions, functor_suffix):
+        ftor_args = ', '.join([f'&{arg.name}' for arg in self.ftor_args])
+
+        if self.funcname in residual_functions:
+            return f'new CostFunction_{functor_suffix}{{{ftor_args}}}'
+
+        # without a residual function, the jacobians come from autodiff
+        return f'gcs::create_scalar_autodiff(new Functor_{functor_suffix}{{{ftor_args}}})'
+
+    def make_residual_statement(self, constraint: 'Constraint', functor_suffix, geom_types, residual_functions):
         return '\n'.join(
             [
                 '        problem.AddResidualBlock(',
-                f'            gcs::create_scalar_autodiff(new Functor_{functor_suffix}{{' + ', '.join([arg.name for arg in self.ftor_args]) + '}),',
+                f'            {self.make_cost_function_instantiation(residual_functions, functor_suffix)},',
                 '            nullptr' 
                     + ''.join([
                         ',\n            ' + f'&{(var + ".value").replace(".", "->", 1)}' 
@@ -94,13 +375,26 @@ class EquationUsage(BaseModel):
             ]
         )
 
-    def make_equation_instantiation(self, constraint: 'Constraint', functor_suffix, geom_types):
-        return 'Equation{{' + ', '.join(
+    def make_equation_instantiation(self, constraint: 'Constraint', functor_suffix, geom_types, residual_functions):
+        assert not self.batch or self.funcname in residual_functions, \
+            f'{constraint.classname} can only batch {self.funcname} with a residual function'
+        return 'arena.make_equation({' + ', '.join(
             [
                 f'{"&" if "." in var else ""}{var.replace(".", "->", 1)}' 
                 for var in self.get_variables(constraint, geom_types)
             ]
-        ) + '}, ' + '[&] (ceres::Problem& problem) {' + self.make_residual_statement(constraint, functor_suffix, geom_types) + '}' + '}'
+        ) + '}, ' + '[&] (ceres::Problem& problem) {' + self.make_residual_statement(constraint, functor_suffix, geom_types, residual_functions) + '}, ' + self.make_equation_form(constraint, functor_suffix, geom_types) + ')'
+
+    def make_equation_form(self, constraint: 'Constraint', functor_suffix, geom_types):
+        # function name and ordered arguments, used to recognise equations that can be solved directly
+        # (and to evaluate them in batches)
+        return f'"{self.funcname}", {{' + ', '.join(
+            [
+                f'&{(var + ".value").replace(".", "->", 1)}'
+                for var in self.get_variables(constraint, geom_types)
+            ]
+            + [f'&{arg.name}' for arg in self.ftor_args]
+        ) + '}' + (f', &CostFunction_{functor_suffix}::evaluate_batch' if self.batch else '')
 
 
 class ConstraintDefinition(BaseModel):
@@ -115,10 +409,32 @@ class ConstraintDefinition(BaseModel):
         ns = self.namespace.replace('.', '::')
         return f'{ns}::{self.classname}'
 
+    @property
+    def typename(self):
+        # name used to make the constraint again when a problem file is loaded
+        return f'{self.namespace}.{self.classname}'
+
     def get_all_vars(self, geom_types) -> List[str]:
         return sum(([f"{gref.name}.{var}" for var in geom_types[gref.type].get_all_vars(geom_types)] for gref in self.geoms), []) + self.variables
 
-    def make_struct(self, geom_types):
+    def get_parameters(self) -> List[str]:
+        return [arg.name for eqn in self.equations for arg in eqn.ftor_args]
+
+    def make_registration(self, geom_types) -> str:
+        # constructor arguments, in the order of get_arguments and get_parameters
+        ctor_args = (
+            [f'args.geometry<{geom_types[gref.type].fullname}>({i})' for i, gref in enumerate(self.geoms)]
+            + [f'args.variable({i + len(self.geoms)})' for i, _ in enumerate(self.variables)]
+            + [f'args.parameter({i})' for i, _ in enumerate(self.get_parameters())]
+        )
+
+        return '\n'.join([
+            f'    registry.add_constraint("{self.typename}", [](const gcs::ConstraintArguments& args) -> gcs::Constraint* {{',
+            f'        return new {self.classname}{{' + ', '.join(ctor_args) + '};',
+            '    });',
+        ])
+
+    def make_struct(self, geom_types, residual_functions):
         param_names = (
             [(geom_types[gref.type].fullname, gref.name) for gref in self.geoms]
             + [('gcs::Variable', var) for var in self.variables]
@@ -135,25 +451,48 @@ class ConstraintDefinition(BaseModel):
                 '',
             ]
             + [eqn.make_functor(self, geom_types, str(i)) for i, eqn in enumerate(self.equations)]
+            + [
+                eqn.make_cost_function(self, geom_types, residual_functions, str(i))
+                for i, eqn in enumerate(self.equations)
+                if eqn.funcname in residual_functions
+            ]
             + [
                 '',
                 '    void add_to_problem(ceres::Problem& problem) {'
             ]
             + [
-                eqn.make_residual_statement(self, str(i), geom_types)
+                eqn.make_residual_statement(self, str(i), geom_types, residual_functions)
                 for i, eqn in enumerate(self.equations)
             ]
             + [
                 '    }',
                 '',
-                '    std::vector<gcs::Equation*> get_equations() const {',
+                '    std::vector<gcs::Equation*> get_equations(gcs::Arena& arena) const {',
                 # f'        return {{{", ".join([eqn.make_equation_instantiation(self, geom_types) for eqn in self.equations])}}};'
                 '        std::vector<gcs::Equation*> eqns{};',
                 '',
-                '\n'.join([f'        eqns.push_back(new {eqn.make_equation_instantiation(self, str(i), geom_types)});' for i, eqn in enumerate(self.equations)]),
+                '\n'.join([f'        eqns.push_back({eqn.make_equation_instantiation(self, str(i), geom_types, residual_functions)});' for i, eqn in enumerate(self.equations)]),
                 '',
                 '        return eqns;',
                 '    }',
+                '',
+                f'    const char* type_name() const {{ return "{self.typename}"; }}',
+                '',
+                '    std::vector<gcs::Constraint::Argument> get_arguments() const {',
+                '        return {' + ', '.join(
+                    [f'{{{gref.name}, nullptr}}' for gref in self.geoms]
+                    + [f'{{nullptr, {var}}}' for var in self.variables]
+                ) + '};',
+                '    }',
+            ]
+            + (
+                [
+                    '',
+                    '    std::vector<double> get_parameters() const { return {' + ', '.join(self.get_parameters()) + '}; }',
+                ]
+                if self.get_parameters() else []
+            )
+            + [
                 '',
                 '};',
             ]
@@ -161,12 +500,16 @@ class ConstraintDefinition(BaseModel):
 
 
 class GcsDefinitions(BaseModel):
+    residual_functions: List[ResidualFunction] = []
     geometry_definitions: List[GeometryDefinition]
     constraint_definitions: List[ConstraintDefinition]
 
     def get_geom_types(self) -> Dict[str, GeometryDefinition]:
         return {f'{geom.namespace}.{geom.classname}': geom for geom in self.geometry_definitions}
 
+    def get_residual_functions(self) -> Dict[str, ResidualFunction]:
+        return {fn.funcname: fn for fn in self.residual_functions}
+
 
 def main():
     import yaml
@@ -176,6 +519,7 @@ def main():
 
     gcs_defs = GcsDefinitions.parse_obj(gcs_data)
     geom_types = gcs_defs.get_geom_types()
+    residual_functions = gcs_defs.get_residual_functions()
 
     ns_extra_constraint_inlcudes = {
         'gcs.basic': [
@@ -217,6 +561,7 @@ def main():
         ])
 
         include_statements = '\n'.join([
+                '#include <string>',
                 '#include <vector>',
                 '#include <ceres/ceres.h>',
                 '#include "gcs/core/core.h"',
@@ -227,11 +572,22 @@ def main():
             for geom in geoms
         ])
 
+        registration = '\n'.join(
+            [
+                '//! Adds the geometry of this namespace to a registry, so that it can be',
+                '//! loaded from a problem file',
+                'inline void register_geometry(gcs::TypeRegistry& registry) {',
+            ]
+            + [geom.make_registration(geom_types) for geom in geoms]
+            + ['}']
+        )
+
         file_contents = '\n\n'.join([
             include_guard_start,
             include_statements,
             namespace_start,
             struct_defs,
+            registration,
             namespace_end,
             include_guard_end,
         ])
@@ -271,6 +627,7 @@ def main():
         ])
 
         include_statements = '\n'.join([
+                '#include <cmath>',
                 '#include <vector>',
                 '#include <ceres/ceres.h>',
                 '#include <metal.hpp>',
@@ -278,15 +635,26 @@ def main():
         ] + ns_extra_constraint_inlcudes.get(ns, []))
 
         struct_defs = '\n\n'.join([
-            cstr.make_struct(geom_types) 
+            cstr.make_struct(geom_types, residual_functions)
             for cstr in constraints
         ])
 
+        registration = '\n'.join(
+            [
+                '//! Adds the constraints of this namespace to a registry, so that they can',
+                '//! be loaded from a problem file',
+                'inline void register_constraints(gcs::TypeRegistry& registry) {',
+            ]
+            + [cstr.make_registration(geom_types) for cstr in constraints]
+            + ['}']
+        )
+
         file_contents = '\n\n'.join([
             include_guard_start,
             include_statements,
             namespace_start,
             struct_defs,
+            registration,
             namespace_end,
             include_guard_end,
         ])